@@ -140,7 +140,9 @@ void clock_cleanup(void) {
 
 void clock_main_loop(void) {
     event_t event;
-    int frame_count = 0;
+    
+    // Update clock display every second
+    gui_set_timer(1000);
     
     while (app_state.running) {
         // Poll for events
@@ -149,20 +151,16 @@ void clock_main_loop(void) {
             
             if (event.type == EVENT_WINDOW_CLOSE) {
                 app_state.running = 0;
+            } else if (event.type == EVENT_TIMER) {
+                clock_update_display();
             }
         }
         
-        // Update clock display every second (20 frames at 20 FPS)
-        if (frame_count % 20 == 0) {
-            clock_update_display();
-        }
-        frame_count++;
-        
         // Redraw
         gui_refresh_screen();
         
-        // Simulate frame rate
-        usleep(50000); // 50ms = ~20 FPS
+        // Sleep until input, a timer or a repaint request
+        gui_wait(-1);
     }
 }
 
@@ -312,8 +312,8 @@ void minesweeper_main_loop(void) {
         // Redraw
         gui_refresh_screen();
         
-        // Simulate frame rate
-        usleep(50000); // 50ms = ~20 FPS
+        // Sleep until input, a timer or a repaint request
+        gui_wait(-1);
     }
 }
 
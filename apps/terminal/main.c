@@ -295,16 +295,15 @@ void terminal_main_loop(void) {
             if (event.type == EVENT_WINDOW_CLOSE) {
                 app_state.running = 0;
             } else if (event.type == EVENT_KEY_PRESS) {
-                // Simple key handling - for now just handle basic commands
-                terminal_input_handler(NULL, 'h'); // Placeholder
+                terminal_input_handler(NULL, event.data.key.key_code);
             }
         }
         
         // Redraw
         gui_refresh_screen();
         
-        // Simulate frame rate
-        usleep(50000); // 50ms = ~20 FPS
+        // Sleep until input, a timer or a repaint request
+        gui_wait(-1);
     }
 }
 
@@ -0,0 +1,247 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include "kernel/kernel.h"
+#include "bench.h"
+
+// Replays allocation patterns against memory_alloc/memory_free and prints
+// one JSON document
+
+typedef struct {
+    uint64_t state;
+} bench_rng_t;
+
+typedef struct {
+    const char* name;
+    size_t max_live;                 // Slots in the working set
+    size_t (*next_size)(bench_rng_t* rng);
+} bench_pattern_t;
+
+typedef struct {
+    void* ptr;
+    size_t size;
+} bench_slot_t;
+
+static uint64_t bench_next(bench_rng_t* rng) {
+    // xorshift64*
+    rng->state ^= rng->state >> 12;
+    rng->state ^= rng->state << 25;
+    rng->state ^= rng->state >> 27;
+    return rng->state * 0x2545F4914F6CDD1Dull;
+}
+
+static double bench_uniform(bench_rng_t* rng) {
+    return (double)(bench_next(rng) >> 11) / (double)(1ull << 53);
+}
+
+// Process images: 64 KiB to 4 MiB, whole pages
+static size_t size_process_image(bench_rng_t* rng) {
+    size_t pages = 16 + bench_next(rng) % (1024 - 16 + 1);
+    return pages * MEMORY_PAGE_SIZE;
+}
+
+// Kernel objects and small buffers: 16 to 512 bytes
+static size_t size_small_object(bench_rng_t* rng) {
+    return 16 + bench_next(rng) % (512 - 16 + 1);
+}
+
+// Pareto sizes with alpha 1.2 from 16 bytes, capped at 1 MiB
+static size_t size_power_law(bench_rng_t* rng) {
+    double u = 1.0 - bench_uniform(rng);
+    double size = 16.0 * pow(u, -1.0 / 1.2);
+    return size > 1048576.0 ? 1048576 : (size_t)size;
+}
+
+static const bench_pattern_t patterns[] = {
+    {"process-churn", 32, size_process_image},
+    {"small-objects", 65536, size_small_object},
+    {"power-law", 8192, size_power_law},
+};
+
+#define PATTERN_COUNT (sizeof(patterns) / sizeof(patterns[0]))
+#define SAMPLE_INTERVAL 256 // Operations between fragmentation samples
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint64_t percentile(uint64_t* samples, size_t count, double p) {
+    if (count == 0) return 0;
+    qsort(samples, count, sizeof(uint64_t), compare_u64);
+    size_t index = (size_t)(p * (double)(count - 1) + 0.5);
+    return samples[index];
+}
+
+static int run_pattern(const bench_pattern_t* pattern, size_t ops, uint64_t seed, FILE* out, int first) {
+    bench_rng_t rng = {seed ? seed : 1};
+    bench_slot_t* slots = calloc(pattern->max_live, sizeof(bench_slot_t));
+    uint64_t* alloc_ns = malloc(sizeof(uint64_t) * ops);
+    uint64_t* free_ns = malloc(sizeof(uint64_t) * ops);
+    if (!slots || !alloc_ns || !free_ns) {
+        free(slots);
+        free(alloc_ns);
+        free(free_ns);
+        return -1;
+    }
+
+    size_t allocs = 0, frees = 0, failures = 0, live = 0;
+    size_t live_bytes = 0;
+    size_t peak_used = 0;
+    double peak_fragmentation = 0.0;
+    double utilization = 0.0;
+
+    uint64_t start = bench_now_ns();
+    for (size_t op = 0; op < ops; op++) {
+        size_t slot = (size_t)(bench_next(&rng) % pattern->max_live);
+
+        // Occupied slots are freed, empty ones filled, so the working set
+        // hovers around half of max_live once warmed up
+        if (slots[slot].ptr) {
+            uint64_t t0 = bench_now_ns();
+            memory_free(slots[slot].ptr);
+            free_ns[frees++] = bench_now_ns() - t0;
+            live_bytes -= slots[slot].size;
+            slots[slot].ptr = NULL;
+            live--;
+        } else {
+            size_t size = pattern->next_size(&rng);
+            uint64_t t0 = bench_now_ns();
+            void* ptr = memory_alloc(size);
+            uint64_t elapsed = bench_now_ns() - t0;
+            if (!ptr) {
+                failures++;
+                continue;
+            }
+            alloc_ns[allocs++] = elapsed;
+            slots[slot].ptr = ptr;
+            slots[slot].size = size;
+            live_bytes += size;
+            live++;
+        }
+
+        if (op % SAMPLE_INTERVAL == 0) {
+            memory_stats_t stats;
+            memory_get_stats(&stats);
+            size_t used = stats.total_bytes - stats.free_bytes;
+            if (stats.fragmentation > peak_fragmentation) {
+                peak_fragmentation = stats.fragmentation;
+            }
+            if (used > peak_used) {
+                peak_used = used;
+                utilization = used ? (double)live_bytes / (double)used : 0.0;
+            }
+        }
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    // Leave the arena empty for the next pattern
+    for (size_t i = 0; i < pattern->max_live; i++) {
+        if (slots[i].ptr) {
+            memory_free(slots[i].ptr);
+        }
+    }
+
+    memory_stats_t stats;
+    memory_get_stats(&stats);
+
+    fprintf(out, "%s    {\n", first ? "" : ",\n");
+    fprintf(out, "      \"pattern\": \"%s\",\n", pattern->name);
+    fprintf(out, "      \"ops\": %zu,\n", allocs + frees);
+    fprintf(out, "      \"allocs\": %zu,\n", allocs);
+    fprintf(out, "      \"frees\": %zu,\n", frees);
+    fprintf(out, "      \"failures\": %zu,\n", failures);
+    fprintf(out, "      \"ops_per_sec\": %.0f,\n",
+            elapsed ? (double)(allocs + frees) * 1e9 / (double)elapsed : 0.0);
+    fprintf(out, "      \"alloc_p50_ns\": %llu,\n", (unsigned long long)percentile(alloc_ns, allocs, 0.50));
+    fprintf(out, "      \"alloc_p99_ns\": %llu,\n", (unsigned long long)percentile(alloc_ns, allocs, 0.99));
+    fprintf(out, "      \"free_p50_ns\": %llu,\n", (unsigned long long)percentile(free_ns, frees, 0.50));
+    fprintf(out, "      \"free_p99_ns\": %llu,\n", (unsigned long long)percentile(free_ns, frees, 0.99));
+    fprintf(out, "      \"peak_fragmentation\": %.4f,\n", peak_fragmentation);
+    fprintf(out, "      \"peak_used_bytes\": %zu,\n", peak_used);
+    fprintf(out, "      \"peak_utilization\": %.4f,\n", utilization);
+    fprintf(out, "      \"final_free_bytes\": %zu\n", stats.free_bytes);
+    fprintf(out, "    }");
+
+    free(slots);
+    free(alloc_ns);
+    free(free_ns);
+    return 0;
+}
+
+static void print_usage(const char* program_name) {
+    fprintf(stderr, "Usage: %s [OPTIONS]\n\n", program_name);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --pattern NAME  Run one pattern (process-churn, small-objects, power-law)\n");
+    fprintf(stderr, "  --ops N         Operations per pattern (default 200000)\n");
+    fprintf(stderr, "  --mem SIZE      Arena size in MiB (default 256)\n");
+    fprintf(stderr, "  --seed N        Random seed (default 1)\n");
+}
+
+int main(int argc, char* argv[]) {
+    static struct option long_options[] = {
+        {"pattern", required_argument, 0, 'p'},
+        {"ops", required_argument, 0, 'o'},
+        {"mem", required_argument, 0, 'm'},
+        {"seed", required_argument, 0, 's'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    const char* only = NULL;
+    size_t ops = 200000;
+    size_t mem_mb = 256;
+    uint64_t seed = 1;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "p:o:m:s:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'p': only = optarg; break;
+            case 'o': ops = strtoull(optarg, NULL, 10); break;
+            case 'm': mem_mb = strtoull(optarg, NULL, 10); break;
+            case 's': seed = strtoull(optarg, NULL, 10); break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    FILE* out = bench_redirect_stdout();
+    if (!out) return 1;
+
+    if (memory_init(mem_mb << 20) != 0) {
+        fprintf(stderr, "Bench: Failed to initialize a %zu MiB arena\n", mem_mb);
+        return 1;
+    }
+
+    fprintf(out, "{\n  \"arena_bytes\": %zu,\n  \"seed\": %llu,\n  \"benchmarks\": [\n",
+            mem_mb << 20, (unsigned long long)seed);
+
+    int first = 1;
+    int status = 0;
+    for (size_t i = 0; i < PATTERN_COUNT; i++) {
+        if (only && strcmp(only, patterns[i].name) != 0) continue;
+        if (run_pattern(&patterns[i], ops, seed, out, first) != 0) {
+            status = 1;
+            break;
+        }
+        first = 0;
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+    fclose(out);
+    memory_cleanup();
+
+    if (first && only) {
+        fprintf(stderr, "Bench: Unknown pattern '%s'\n", only);
+        return 1;
+    }
+    return status;
+}
@@ -0,0 +1,140 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include "kernel/kernel.h"
+#include "bench.h"
+
+// Alternates a hot working set with sequential scans several times the
+// size of the buffer cache and prints one JSON document: how much of the
+// hot set survives the scans, where LRU would keep none of it, and what a
+// hit costs
+
+// Returns 1 if the block was already cached
+static int bench_touch(buffer_cache_t* cache, uint64_t block) {
+    uint64_t hits = cache->hits;
+    bcache_buffer_t* buffer = bcache_get(cache, block);
+    if (!buffer) return 0;
+    bcache_release(cache, buffer);
+    return cache->hits != hits;
+}
+
+static void print_usage(const char* program_name) {
+    fprintf(stderr, "Usage: %s [OPTIONS]\n\n", program_name);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --image FILE   Disk image to create (default /tmp/mindose-bcache-bench.img)\n");
+    fprintf(stderr, "  --rounds N     Hot set uses, each followed by a scan (default 20)\n");
+    fprintf(stderr, "  --scan N       Scan length in cache sizes (default 4)\n");
+}
+
+int main(int argc, char* argv[]) {
+    static struct option long_options[] = {
+        {"image", required_argument, 0, 'i'},
+        {"rounds", required_argument, 0, 'r'},
+        {"scan", required_argument, 0, 's'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    const char* image = "/tmp/mindose-bcache-bench.img";
+    size_t rounds = 20;
+    size_t scan_factor = 4;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "i:r:s:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'i': image = optarg; break;
+            case 'r': rounds = strtoull(optarg, NULL, 10); break;
+            case 's': scan_factor = strtoull(optarg, NULL, 10); break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (rounds < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // 64 MB of memory at 5% gives a cache of 819 blocks
+    int fd = open(image, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)256 << 20) != 0) {
+        fprintf(stderr, "Bench: Cannot create %s\n", image);
+        return 1;
+    }
+    close(fd);
+
+    FILE* out = bench_redirect_stdout();
+    if (!out) return 1;
+
+    mindose_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.mem_size = "64M";
+    config.diskimage = (char*)image;
+    buffer_cache_t* cache = kernel_init(&config) == 0 ? device_get_cache() : NULL;
+    if (!cache) {
+        fprintf(stderr, "Bench: No buffer cache on %s\n", image);
+        return 1;
+    }
+
+    // A quarter of the cache is hot, like metadata read twice in a row
+    // between data scans; scans only read blocks never seen before
+    uint64_t hot = cache->capacity / 4;
+    uint64_t scan = cache->capacity * scan_factor;
+    uint64_t next_scan = hot;
+    uint64_t block_count = device_get_disk()->block_count;
+    uint64_t hot_hits = 0;
+    uint64_t hot_lookups = 0;
+
+    for (size_t round = 0; round < rounds; round++) {
+        for (int pass = 0; pass < 2; pass++) {
+            for (uint64_t block = 0; block < hot; block++) {
+                int hit = bench_touch(cache, block);
+                // Only the first pass after a scan tells anything
+                if (round > 0 && pass == 0) {
+                    hot_hits += (uint64_t)hit;
+                    hot_lookups++;
+                }
+            }
+        }
+        for (uint64_t i = 0; i < scan; i++) {
+            bench_touch(cache, next_scan);
+            next_scan = next_scan + 1 < block_count ? next_scan + 1 : hot;
+        }
+    }
+
+    // Hit cost on the hot set alone
+    size_t hit_rounds = 1000;
+    uint64_t start = bench_now_ns();
+    for (size_t round = 0; round < hit_rounds; round++) {
+        for (uint64_t block = 0; block < hot; block++) {
+            bench_touch(cache, block);
+        }
+    }
+    uint64_t hit_elapsed = bench_now_ns() - start;
+
+    bcache_stats_t stats;
+    bcache_get_stats(cache, &stats);
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"capacity\": %zu,\n", stats.capacity);
+    fprintf(out, "  \"hot_blocks\": %llu,\n", (unsigned long long)hot);
+    fprintf(out, "  \"scan_blocks\": %llu,\n", (unsigned long long)scan);
+    fprintf(out, "  \"hot_hit_ratio\": %.3f,\n", hot_lookups ? (double)hot_hits / (double)hot_lookups : 0.0);
+    fprintf(out, "  \"hit_ns\": %.1f,\n", (double)hit_elapsed / (double)(hit_rounds * hot));
+    fprintf(out, "  \"promotions\": %llu,\n", (unsigned long long)stats.promotions);
+    fprintf(out, "  \"ghost_hits\": %llu,\n", (unsigned long long)stats.ghost_hits);
+    fprintf(out, "  \"evictions\": %llu\n", (unsigned long long)stats.evictions);
+    fprintf(out, "}\n");
+    fclose(out);
+
+    kernel_cleanup();
+    unlink(image);
+    return 0;
+}
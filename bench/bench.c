@@ -0,0 +1,23 @@
+#define _GNU_SOURCE
+#include "bench.h"
+#include <time.h>
+#include <unistd.h>
+
+uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+FILE* bench_redirect_stdout(void) {
+    fflush(stdout);
+    FILE* out = fdopen(dup(STDOUT_FILENO), "w");
+    if (!out || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+        fprintf(stderr, "Bench: Cannot redirect output\n");
+        if (out) {
+            fclose(out);
+        }
+        return NULL;
+    }
+    return out;
+}
@@ -0,0 +1,16 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Shared by the benchmarks. Each prints one JSON document on stdout, so
+// anything the kernel or a channel logs is sent to stderr instead.
+
+uint64_t bench_now_ns(void);
+
+// Point stdout at stderr and return a stream on the original stdout for the
+// JSON, or NULL if that fails
+FILE* bench_redirect_stdout(void);
+
+#endif // BENCH_H
@@ -0,0 +1,131 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include "kernel/kernel.h"
+#include "bench.h"
+
+// Reads a disk image through the mapped block device and through pread,
+// then writes it back in batches, and prints one JSON document
+
+// Both read paths look at every word, so neither wins by skipping the data
+static uint64_t bench_checksum(const void* block) {
+    const uint64_t* words = block;
+    uint64_t sum = 0;
+    for (size_t i = 0; i < BLOCK_SIZE / sizeof(uint64_t); i++) {
+        sum += words[i];
+    }
+    return sum;
+}
+
+static void print_usage(const char* program_name) {
+    fprintf(stderr, "Usage: %s [OPTIONS]\n\n", program_name);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --image FILE   Disk image to create (default /tmp/mindose-block-bench.img)\n");
+    fprintf(stderr, "  --size MB      Image size in megabytes (default 64)\n");
+    fprintf(stderr, "  --passes N     Read passes over the device (default 8)\n");
+}
+
+int main(int argc, char* argv[]) {
+    static struct option long_options[] = {
+        {"image", required_argument, 0, 'i'},
+        {"size", required_argument, 0, 's'},
+        {"passes", required_argument, 0, 'p'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    const char* image = "/tmp/mindose-block-bench.img";
+    size_t size_mb = 64;
+    size_t passes = 8;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "i:s:p:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'i': image = optarg; break;
+            case 's': size_mb = strtoull(optarg, NULL, 10); break;
+            case 'p': passes = strtoull(optarg, NULL, 10); break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (size_mb == 0 || passes == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    int fd = open(image, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)(size_mb << 20)) != 0) {
+        fprintf(stderr, "Bench: Cannot create %s\n", image);
+        return 1;
+    }
+
+    FILE* out = bench_redirect_stdout();
+    if (!out) return 1;
+
+    mindose_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.mem_size = "64M";
+    config.diskimage = (char*)image;
+    block_device_t* disk = kernel_init(&config) == 0 ? device_get_disk() : NULL;
+    if (!disk) {
+        fprintf(stderr, "Bench: No block device on %s\n", image);
+        return 1;
+    }
+
+    // Fill the device so both read paths see real data
+    uint8_t* buffer = malloc(BLOCK_SIZE);
+    if (!buffer) return 1;
+    uint64_t start = bench_now_ns();
+    for (uint64_t block = 0; block < disk->block_count; block++) {
+        memset(buffer, (int)(block & 0xFF), BLOCK_SIZE);
+        block_write(disk, block, buffer, 1);
+    }
+    block_sync(disk);
+    uint64_t write_elapsed = bench_now_ns() - start;
+
+    volatile uint64_t sink = 0;
+    start = bench_now_ns();
+    for (size_t pass = 0; pass < passes; pass++) {
+        for (uint64_t block = 0; block < disk->block_count; block++) {
+            sink += bench_checksum(block_read(disk, block, 1));
+        }
+    }
+    uint64_t mapped_elapsed = bench_now_ns() - start;
+
+    start = bench_now_ns();
+    for (size_t pass = 0; pass < passes; pass++) {
+        for (uint64_t block = 0; block < disk->block_count; block++) {
+            if (pread(fd, buffer, BLOCK_SIZE, (off_t)(block * BLOCK_SIZE)) != BLOCK_SIZE) break;
+            sink += bench_checksum(buffer);
+        }
+    }
+    uint64_t pread_elapsed = bench_now_ns() - start;
+
+    block_stats_t stats;
+    block_get_stats(disk, &stats);
+    uint64_t reads = disk->block_count * passes;
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"blocks\": %llu,\n", (unsigned long long)stats.block_count);
+    fprintf(out, "  \"mapped_read_ns_per_block\": %.1f,\n", (double)mapped_elapsed / (double)reads);
+    fprintf(out, "  \"pread_ns_per_block\": %.1f,\n", (double)pread_elapsed / (double)reads);
+    fprintf(out, "  \"write_ns_per_block\": %.1f,\n", (double)write_elapsed / (double)stats.block_count);
+    fprintf(out, "  \"msync_calls\": %llu,\n", (unsigned long long)stats.syncs);
+    fprintf(out, "  \"synced_blocks\": %llu\n", (unsigned long long)stats.synced_blocks);
+    fprintf(out, "}\n");
+    fclose(out);
+
+    free(buffer);
+    kernel_cleanup();
+    close(fd);
+    unlink(image);
+    return 0;
+}
@@ -0,0 +1,177 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+#include <getopt.h>
+#include "kernel/kernel.h"
+#include "bench.h"
+
+// Measures what a context switch costs and prints one JSON document
+
+#define BENCH_STACK_SIZE ((size_t)64 << 10)
+
+// Bare swapcontext ping-pong, the floor under everything else
+static ucontext_t raw_main;
+static ucontext_t raw_peer;
+static size_t raw_rounds;
+
+static void raw_peer_main(void) {
+    for (;;) {
+        swapcontext(&raw_peer, &raw_main);
+    }
+}
+
+static double bench_raw(size_t rounds) {
+    void* stack = malloc(BENCH_STACK_SIZE);
+    if (!stack) return 0.0;
+
+    getcontext(&raw_peer);
+    raw_peer.uc_stack.ss_sp = stack;
+    raw_peer.uc_stack.ss_size = BENCH_STACK_SIZE;
+    raw_peer.uc_link = NULL;
+    makecontext(&raw_peer, raw_peer_main, 0);
+
+    raw_rounds = rounds;
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < raw_rounds; i++) {
+        swapcontext(&raw_main, &raw_peer);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    free(stack);
+    return (double)elapsed / (double)(rounds * 2);
+}
+
+// Processes that do nothing but yield: every switch is a round trip through
+// the scheduler loop
+static void yield_main(void* arg) {
+    size_t rounds = (size_t)(uintptr_t)arg;
+    for (size_t i = 0; i < rounds; i++) {
+        process_switch();
+    }
+}
+
+// CPU-bound processes only leave when the timer preempts them
+static volatile uint64_t spin_sink;
+
+static void spin_main(void* arg) {
+    uint64_t until = bench_now_ns() + (uint64_t)(uintptr_t)arg * 1000000ull;
+    while (bench_now_ns() < until) {
+        spin_sink++;
+    }
+}
+
+static int start_processes(size_t count, process_entry_t entry, void* arg) {
+    for (size_t i = 0; i < count; i++) {
+        uint32_t pid = process_create("bench", NULL, MEMORY_PAGE_SIZE);
+        if (!pid || process_start(pid, entry, arg) != 0) return -1;
+    }
+    return 0;
+}
+
+static void print_usage(const char* program_name) {
+    fprintf(stderr, "Usage: %s [OPTIONS]\n\n", program_name);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --processes N   Processes switching between each other (default 4)\n");
+    fprintf(stderr, "  --rounds N      Yields per process (default 100000)\n");
+    fprintf(stderr, "  --tick US       Preemption timer interval in microseconds (default 1000)\n");
+    fprintf(stderr, "  --spin MS       Wall time each CPU-bound process runs (default 200)\n");
+    fprintf(stderr, "  --cpus N        Simulated CPUs, one host thread each (default 1)\n");
+}
+
+int main(int argc, char* argv[]) {
+    static struct option long_options[] = {
+        {"processes", required_argument, 0, 'p'},
+        {"rounds", required_argument, 0, 'r'},
+        {"tick", required_argument, 0, 't'},
+        {"spin", required_argument, 0, 's'},
+        {"cpus", required_argument, 0, 'c'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    size_t processes = 4;
+    size_t rounds = 100000;
+    unsigned tick_us = 1000;
+    size_t spin_ms = 200;
+    int cpus = 1;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "p:r:t:s:c:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'p': processes = strtoull(optarg, NULL, 10); break;
+            case 'r': rounds = strtoull(optarg, NULL, 10); break;
+            case 't': tick_us = (unsigned)strtoul(optarg, NULL, 10); break;
+            case 's': spin_ms = strtoull(optarg, NULL, 10); break;
+            case 'c': cpus = atoi(optarg); break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (processes == 0 || rounds == 0 || tick_us == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FILE* out = bench_redirect_stdout();
+    if (!out) return 1;
+
+    mindose_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.mem_size = "64M";
+    config.cpus = cpus;
+    if (kernel_init(&config) != 0) {
+        fprintf(stderr, "Bench: Failed to initialize the kernel\n");
+        return 1;
+    }
+
+    double raw_ns = bench_raw(rounds);
+
+    if (start_processes(processes, yield_main, (void*)(uintptr_t)rounds) != 0) {
+        fprintf(stderr, "Bench: Failed to start yielding processes\n");
+        return 1;
+    }
+    // Switches on every CPU count; per-switch cost is in CPU time
+    scheduler_stats_t before, after;
+    scheduler_get_stats(&before);
+    uint64_t start = bench_now_ns();
+    scheduler_run();
+    uint64_t yield_elapsed = bench_now_ns() - start;
+    scheduler_get_stats(&after);
+    uint64_t yield_switches = after.switches - before.switches;
+
+    if (start_processes(processes, spin_main, (void*)(uintptr_t)spin_ms) != 0 ||
+        scheduler_set_timer(tick_us) != 0) {
+        fprintf(stderr, "Bench: Failed to start CPU-bound processes\n");
+        return 1;
+    }
+    scheduler_get_stats(&before);
+    start = bench_now_ns();
+    scheduler_run();
+    uint64_t spin_elapsed = bench_now_ns() - start;
+    scheduler_get_stats(&after);
+    uint64_t spin_switches = after.switches - before.switches;
+    scheduler_set_timer(0);
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"cpus\": %u,\n", after.cpus);
+    fprintf(out, "  \"processes\": %zu,\n", processes);
+    fprintf(out, "  \"raw_swapcontext_ns\": %.1f,\n", raw_ns);
+    fprintf(out, "  \"yield_switches\": %llu,\n", (unsigned long long)yield_switches);
+    fprintf(out, "  \"yield_switch_ns\": %.1f,\n",
+            yield_switches ? (double)yield_elapsed * after.cpus / (double)yield_switches : 0.0);
+    fprintf(out, "  \"tick_us\": %u,\n", tick_us);
+    fprintf(out, "  \"preempt_switches\": %llu,\n", (unsigned long long)spin_switches);
+    fprintf(out, "  \"preempt_switches_per_sec\": %.0f\n",
+            spin_elapsed ? (double)spin_switches * 1e9 / (double)spin_elapsed : 0.0);
+    fprintf(out, "}\n");
+    fclose(out);
+
+    kernel_cleanup();
+    return 0;
+}
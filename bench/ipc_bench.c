@@ -0,0 +1,189 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include "kernel/ipc.h"
+#include "bench.h"
+
+// Measures IPC channel latency between two host processes and MPSC
+// throughput between threads, and prints one JSON document
+
+#define BENCH_PRODUCERS_MAX 16
+
+// Spin a while on an empty or full ring before giving the CPU away, so a
+// peer sharing the CPU gets to run
+static void bench_relax(unsigned* spins) {
+    if (++*spins >= 1000) {
+        *spins = 0;
+        sched_yield();
+    }
+}
+
+// Child side of the ping-pong: echo every message back
+static void bench_echo(size_t rounds, int sleep_between) {
+    ipc_channel_t* ping = ipc_channel_open("mindose-bench-ping");
+    ipc_channel_t* pong = ipc_channel_open("mindose-bench-pong");
+    if (!ping || !pong) _exit(1);
+
+    uint64_t value;
+    unsigned spins = 0;
+    for (size_t i = 0; i < rounds; i++) {
+        while (ipc_channel_receive(ping, &value, sizeof(value), NULL) != 0) {
+            if (sleep_between) {
+                ipc_channel_wait(ping, -1);
+            } else {
+                bench_relax(&spins);
+            }
+        }
+        while (ipc_channel_send(pong, &value, sizeof(value)) != 0) {
+            bench_relax(&spins);
+        }
+    }
+    _exit(0);
+}
+
+// Round trips through a pair of SPSC channels to a forked child, either
+// spinning on the ring or sleeping on the doorbell; returns ns per one-way hop
+static double bench_ping_pong(size_t rounds, int sleep_between) {
+    ipc_channel_t* ping = ipc_channel_create("mindose-bench-ping", IPC_SPSC, sizeof(uint64_t), 64);
+    ipc_channel_t* pong = ipc_channel_create("mindose-bench-pong", IPC_SPSC, sizeof(uint64_t), 64);
+    if (!ping || !pong) return 0.0;
+
+    fflush(stdout);
+    pid_t child = fork();
+    if (child == 0) {
+        bench_echo(rounds, sleep_between);
+    }
+    if (child < 0) return 0.0;
+
+    unsigned spins = 0;
+    uint64_t start = bench_now_ns();
+    for (uint64_t i = 0; i < rounds; i++) {
+        uint64_t value = i;
+        while (ipc_channel_send(ping, &value, sizeof(value)) != 0) {
+            bench_relax(&spins);
+        }
+        while (ipc_channel_receive(pong, &value, sizeof(value), NULL) != 0) {
+            if (sleep_between) {
+                ipc_channel_wait(pong, -1);
+            } else {
+                bench_relax(&spins);
+            }
+        }
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    int status;
+    waitpid(child, &status, 0);
+    ipc_channel_close(ping);
+    ipc_channel_close(pong);
+    return (double)elapsed / (double)(rounds * 2);
+}
+
+typedef struct {
+    ipc_channel_t* channel;
+    size_t messages;
+} bench_producer_t;
+
+static void* bench_produce(void* arg) {
+    bench_producer_t* producer = arg;
+    unsigned spins = 0;
+    for (uint64_t i = 0; i < producer->messages; i++) {
+        while (ipc_channel_send(producer->channel, &i, sizeof(i)) != 0) {
+            bench_relax(&spins);
+        }
+    }
+    return NULL;
+}
+
+// Several producer threads into one MPSC channel; returns messages per second
+static double bench_mpsc(size_t producers, size_t messages) {
+    ipc_channel_t* channel = ipc_channel_create("mindose-bench-mpsc", IPC_MPSC, 64, 1024);
+    if (!channel) return 0.0;
+
+    pthread_t threads[BENCH_PRODUCERS_MAX];
+    bench_producer_t producer = {channel, messages};
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < producers; i++) {
+        pthread_create(&threads[i], NULL, bench_produce, &producer);
+    }
+    uint64_t value;
+    unsigned spins = 0;
+    for (size_t received = 0; received < producers * messages;) {
+        if (ipc_channel_receive(channel, &value, sizeof(value), NULL) == 0) {
+            received++;
+        } else {
+            bench_relax(&spins);
+        }
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    for (size_t i = 0; i < producers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    ipc_channel_close(channel);
+    return (double)(producers * messages) * 1e9 / (double)elapsed;
+}
+
+static void print_usage(const char* program_name) {
+    fprintf(stderr, "Usage: %s [OPTIONS]\n\n", program_name);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --rounds N      Ping-pong round trips (default 200000)\n");
+    fprintf(stderr, "  --producers N   MPSC producer threads (default 4)\n");
+    fprintf(stderr, "  --messages N    Messages per producer (default 1000000)\n");
+}
+
+int main(int argc, char* argv[]) {
+    static struct option long_options[] = {
+        {"rounds", required_argument, 0, 'r'},
+        {"producers", required_argument, 0, 'p'},
+        {"messages", required_argument, 0, 'm'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    size_t rounds = 200000;
+    size_t producers = 4;
+    size_t messages = 1000000;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "r:p:m:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'r': rounds = strtoull(optarg, NULL, 10); break;
+            case 'p': producers = strtoull(optarg, NULL, 10); break;
+            case 'm': messages = strtoull(optarg, NULL, 10); break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (rounds == 0 || producers == 0 || producers > BENCH_PRODUCERS_MAX || messages == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FILE* out = bench_redirect_stdout();
+    if (!out) return 1;
+
+    double spin_ns = bench_ping_pong(rounds, 0);
+    double doorbell_ns = bench_ping_pong(rounds / 10 ? rounds / 10 : 1, 1);
+    double mpsc_rate = bench_mpsc(producers, messages);
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"rounds\": %zu,\n", rounds);
+    fprintf(out, "  \"spin_one_way_ns\": %.1f,\n", spin_ns);
+    fprintf(out, "  \"doorbell_one_way_ns\": %.1f,\n", doorbell_ns);
+    fprintf(out, "  \"mpsc_producers\": %zu,\n", producers);
+    fprintf(out, "  \"mpsc_messages_per_sec\": %.0f\n", mpsc_rate);
+    fprintf(out, "}\n");
+    fclose(out);
+    return spin_ns > 0.0 && doorbell_ns > 0.0 && mpsc_rate > 0.0 ? 0 : 1;
+}
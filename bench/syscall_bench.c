@@ -0,0 +1,110 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "kernel/kernel.h"
+#include "bench.h"
+
+// Compares one kernel transition per system call against batches through
+// the submission ring and prints one JSON document
+
+static void print_usage(const char* program_name) {
+    fprintf(stderr, "Usage: %s [OPTIONS]\n\n", program_name);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --calls N       System calls per run (default 1000000)\n");
+    fprintf(stderr, "  --batch N       Ring entries per submission, a power of two (default 32)\n");
+}
+
+int main(int argc, char* argv[]) {
+    static struct option long_options[] = {
+        {"calls", required_argument, 0, 'n'},
+        {"batch", required_argument, 0, 'b'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    size_t calls = 1000000;
+    uint32_t batch = 32;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:b:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n': calls = strtoull(optarg, NULL, 10); break;
+            case 'b': batch = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (calls == 0 || batch == 0 || (batch & (batch - 1))) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FILE* out = bench_redirect_stdout();
+    if (!out) return 1;
+
+    mindose_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.mem_size = "64M";
+    if (kernel_init(&config) != 0) {
+        fprintf(stderr, "Bench: Failed to initialize the kernel\n");
+        return 1;
+    }
+
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < calls; i++) {
+        syscall_handler(SYS_GETPID, NULL);
+    }
+    uint64_t direct_elapsed = bench_now_ns() - start;
+
+    syscall_ring_t ring;
+    if (syscall_ring_init(&ring, batch) != 0) {
+        fprintf(stderr, "Bench: Failed to set up the ring\n");
+        return 1;
+    }
+    size_t completed = 0;
+    start = bench_now_ns();
+    for (size_t done = 0; done < calls;) {
+        syscall_sqe_t* sqe;
+        while (done < calls && (sqe = syscall_ring_get_sqe(&ring)) != NULL) {
+            sqe->call = SYS_GETPID;
+            sqe->args = NULL;
+            sqe->user_data = done++;
+        }
+        syscall_ring_submit(&ring);
+        while (syscall_ring_peek_cqe(&ring)) {
+            syscall_ring_cqe_seen(&ring);
+            completed++;
+        }
+    }
+    uint64_t ring_elapsed = bench_now_ns() - start;
+    syscall_ring_destroy(&ring);
+
+    // The handler itself, as the latency counters saw it
+    syscall_stat_t stats[SYSCALL_MAX];
+    size_t count = syscall_get_stats(stats, SYSCALL_MAX);
+    double handler_ns = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        if (stats[i].call == SYS_GETPID) {
+            handler_ns = (double)stats[i].total_ns / (double)stats[i].calls;
+        }
+    }
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"calls\": %zu,\n", calls);
+    fprintf(out, "  \"batch\": %u,\n", batch);
+    fprintf(out, "  \"direct_ns_per_call\": %.1f,\n", (double)direct_elapsed / (double)calls);
+    fprintf(out, "  \"ring_ns_per_call\": %.1f,\n", (double)ring_elapsed / (double)calls);
+    fprintf(out, "  \"ring_completions\": %zu,\n", completed);
+    fprintf(out, "  \"handler_ns\": %.1f\n", handler_ns);
+    fprintf(out, "}\n");
+    fclose(out);
+
+    kernel_cleanup();
+    return completed == calls ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "kernel/timerwheel.h"
+#include "bench.h"
+
+// Measures timer wheel insert, cancel and expiry cost with many pending
+// timers and prints one JSON document
+
+// xorshift64, deterministic across runs
+static uint64_t bench_rng = 88172645463325252ull;
+
+static uint64_t bench_random(void) {
+    bench_rng ^= bench_rng << 13;
+    bench_rng ^= bench_rng >> 7;
+    bench_rng ^= bench_rng << 17;
+    return bench_rng;
+}
+
+static size_t fired;
+
+static void bench_fire(void* arg) {
+    (void)arg;
+    fired++;
+}
+
+static void print_usage(const char* program_name) {
+    fprintf(stderr, "Usage: %s [OPTIONS]\n\n", program_name);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --timers N      Timers pending at once (default 500000)\n");
+    fprintf(stderr, "  --span MS       Timeouts are spread over this many ticks (default 600000)\n");
+}
+
+int main(int argc, char* argv[]) {
+    static struct option long_options[] = {
+        {"timers", required_argument, 0, 'n'},
+        {"span", required_argument, 0, 's'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    size_t count = 500000;
+    uint64_t span = 600000;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:s:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n': count = strtoull(optarg, NULL, 10); break;
+            case 's': span = strtoull(optarg, NULL, 10); break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (count == 0 || span == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    wheel_timer_t* timers = malloc(count * sizeof(wheel_timer_t));
+    timer_wheel_t* wheel = malloc(sizeof(timer_wheel_t));
+    if (!timers || !wheel) {
+        fprintf(stderr, "Bench: Out of memory\n");
+        return 1;
+    }
+    timer_wheel_init(wheel, 0);
+    for (size_t i = 0; i < count; i++) {
+        wheel_timer_init(&timers[i], bench_fire, NULL);
+    }
+
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < count; i++) {
+        timer_wheel_add(wheel, &timers[i], 1 + bench_random() % span);
+    }
+    uint64_t insert_elapsed = bench_now_ns() - start;
+    size_t peak_pending = wheel->pending;
+
+    // Timeouts mostly get cancelled before they fire; re-arm a quarter,
+    // the way a busy connection pushes its deadline out
+    start = bench_now_ns();
+    for (size_t i = 0; i < count; i += 2) {
+        timer_wheel_cancel(wheel, &timers[i]);
+    }
+    uint64_t cancel_elapsed = bench_now_ns() - start;
+
+    start = bench_now_ns();
+    for (size_t i = 1; i < count; i += 4) {
+        timer_wheel_add(wheel, &timers[i], 1 + bench_random() % span);
+    }
+    uint64_t rearm_elapsed = bench_now_ns() - start;
+
+    // Walk the wheel one tick at a time through the whole span, the way a
+    // 1 ms clock would drive it, cascades included
+    size_t expected = wheel->pending;
+    start = bench_now_ns();
+    for (uint64_t tick = 1; tick <= span; tick++) {
+        timer_wheel_run(timer_wheel_advance(wheel, tick));
+    }
+    uint64_t expire_elapsed = bench_now_ns() - start;
+
+    size_t cancelled = (count + 1) / 2;
+    size_t rearmed = count / 4;
+
+    printf("{\n");
+    printf("  \"timers\": %zu,\n", count);
+    printf("  \"span_ticks\": %llu,\n", (unsigned long long)span);
+    printf("  \"peak_pending\": %zu,\n", peak_pending);
+    printf("  \"insert_ns\": %.1f,\n", (double)insert_elapsed / (double)count);
+    printf("  \"cancel_ns\": %.1f,\n", (double)cancel_elapsed / (double)cancelled);
+    printf("  \"rearm_ns\": %.1f,\n", rearmed ? (double)rearm_elapsed / (double)rearmed : 0.0);
+    printf("  \"fired\": %zu,\n", fired);
+    printf("  \"fired_expected\": %zu,\n", expected);
+    printf("  \"expire_ns_per_timer\": %.1f,\n", fired ? (double)expire_elapsed / (double)fired : 0.0);
+    printf("  \"tick_ns\": %.1f\n", (double)expire_elapsed / (double)span);
+    printf("}\n");
+
+    free(wheel);
+    free(timers);
+    return fired == expected ? 0 : 1;
+}
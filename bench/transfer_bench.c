@@ -0,0 +1,160 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "kernel/kernel.h"
+#include "bench.h"
+
+// Passes a buffer back and forth between two processes, once by moving its
+// pages and once by copying it, and prints one JSON document
+
+static size_t bench_pages;
+static size_t bench_rounds;
+static uint32_t bench_pids[2];
+static uint8_t* bench_scratch;
+static uint64_t bench_move_ns;
+static uint64_t bench_copy_ns;
+
+// Fill the buffer with different contents on every page, so the merge
+// scanner does not fold its frames together
+static void bench_fill(process_t* process) {
+    size_t size = bench_pages * MEMORY_PAGE_SIZE;
+    for (size_t i = 0; i < size; i++) {
+        bench_scratch[i] = (uint8_t)(i * 31 + i / MEMORY_PAGE_SIZE);
+    }
+    paging_write(process->address_space, PROCESS_MEMORY_BASE, bench_scratch, size);
+}
+
+// Process 0 starts with the buffer in its own memory; each round it goes
+// to process 1 and comes back
+static void move_main(void* arg) {
+    int side = (int)(uintptr_t)arg;
+    size_t size = bench_pages * MEMORY_PAGE_SIZE;
+    vaddr_t addr = PROCESS_MEMORY_BASE;
+    page_message_t message;
+
+    if (side == 0) {
+        bench_fill(process_get_current());
+    }
+
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < bench_rounds; i++) {
+        if (side == 1) {
+            if (process_page_receive(&message, 0) != 0) return;
+            addr = message.addr;
+        }
+        if (process_page_send(bench_pids[!side], addr, size, PAGE_SEND_MOVE) != 0) return;
+        if (side == 0) {
+            if (process_page_receive(&message, 0) != 0) return;
+            addr = message.addr;
+        }
+    }
+    if (side == 0) {
+        bench_move_ns = bench_now_ns() - start;
+    }
+}
+
+// The copying baseline: read the buffer out of one space and write it
+// into the other, as a kernel without page transfer would
+static void bench_copy(process_t* from, process_t* to) {
+    size_t size = bench_pages * MEMORY_PAGE_SIZE;
+    bench_fill(from);
+
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < bench_rounds * 2; i++) {
+        paging_read(from->address_space, PROCESS_MEMORY_BASE, bench_scratch, size);
+        paging_write(to->address_space, PROCESS_MEMORY_BASE, bench_scratch, size);
+        process_t* swap = from;
+        from = to;
+        to = swap;
+    }
+    bench_copy_ns = bench_now_ns() - start;
+}
+
+static void print_usage(const char* program_name) {
+    fprintf(stderr, "Usage: %s [OPTIONS]\n\n", program_name);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --pages N    Pages in the buffer (default 64)\n");
+    fprintf(stderr, "  --rounds N   Round trips between the two processes (default 5000)\n");
+}
+
+int main(int argc, char* argv[]) {
+    static struct option long_options[] = {
+        {"pages", required_argument, 0, 'p'},
+        {"rounds", required_argument, 0, 'r'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    bench_pages = 64;
+    bench_rounds = 5000;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "p:r:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'p': bench_pages = strtoull(optarg, NULL, 10); break;
+            case 'r': bench_rounds = strtoull(optarg, NULL, 10); break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (bench_pages == 0 || bench_rounds == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FILE* out = bench_redirect_stdout();
+    if (!out) return 1;
+
+    mindose_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.mem_size = "64M";
+    if (kernel_init(&config) != 0) {
+        fprintf(stderr, "Bench: Failed to initialize the kernel\n");
+        return 1;
+    }
+
+    size_t size = bench_pages * MEMORY_PAGE_SIZE;
+    bench_scratch = malloc(size);
+    for (int i = 0; i < 2; i++) {
+        bench_pids[i] = process_create("bench", NULL, size);
+    }
+    if (!bench_scratch || !bench_pids[0] || !bench_pids[1]) {
+        fprintf(stderr, "Bench: Failed to create processes\n");
+        return 1;
+    }
+
+    bench_copy(process_find(bench_pids[0]), process_find(bench_pids[1]));
+
+    paging_stats_t before, after;
+    paging_get_stats(&before);
+    for (int i = 0; i < 2; i++) {
+        if (process_start(bench_pids[i], move_main, (void*)(uintptr_t)i) != 0) {
+            fprintf(stderr, "Bench: Failed to start processes\n");
+            return 1;
+        }
+    }
+    scheduler_run();
+    paging_get_stats(&after);
+
+    size_t moves = bench_rounds * 2;
+    fprintf(out, "{\n");
+    fprintf(out, "  \"pages\": %zu,\n", bench_pages);
+    fprintf(out, "  \"rounds\": %zu,\n", bench_rounds);
+    fprintf(out, "  \"copy_ns_per_page\": %.1f,\n", (double)bench_copy_ns / (double)(moves * bench_pages));
+    fprintf(out, "  \"move_ns_per_page\": %.1f,\n",
+            bench_move_ns ? (double)bench_move_ns / (double)(moves * bench_pages) : 0.0);
+    fprintf(out, "  \"pages_moved\": %zu,\n", after.pages_moved - before.pages_moved);
+    fprintf(out, "  \"cow_copies\": %zu\n", after.cow_copies - before.cow_copies);
+    fprintf(out, "}\n");
+    fclose(out);
+
+    free(bench_scratch);
+    kernel_cleanup();
+    return 0;
+}
@@ -11,6 +11,11 @@ typedef struct {
     char* iso;
     char* arch;
     int application_mode;
+    int huge_pages;
+    char* zram_size;
+    int mem_trace;
+    int cpus;
+    int bcache_percent; // Buffer cache share of mem_size, 0 for the default, BCACHE_DISABLED for none
 } mindose_config_t;
 
 #endif // COMMON_H
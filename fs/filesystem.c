@@ -1,5 +1,6 @@
 #define _GNU_SOURCE
 #include "filesystem.h"
+#include "procfs.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -71,6 +72,7 @@ int filesystem_init(mindose_config_t* config) {
     fs_state.root->subdir_count = 0;
     fs_state.root->subdir_capacity = 0;
     fs_state.root->parent = NULL;
+    fs_state.root->refresh = NULL;
     
     fs_state.current_dir = fs_state.root;
     fs_state.next_inode = 1;
@@ -80,6 +82,10 @@ int filesystem_init(mindose_config_t* config) {
         fprintf(stderr, "FileSystem: Failed to create standard directories\n");
         return -1;
     }
+    if (procfs_init() != 0) {
+        fprintf(stderr, "FileSystem: Failed to mount %s\n", PROCFS_PATH);
+        return -1;
+    }
     
     printf("FileSystem: Initialized with standard directory structure\n");
     return 0;
@@ -157,6 +163,7 @@ directory_t* fs_create_directory(const char* path) {
             new_dir->subdir_count = 0;
             new_dir->subdir_capacity = 0;
             new_dir->parent = current;
+            new_dir->refresh = NULL;
             
             current->subdir_count++;
             current = new_dir;
@@ -287,12 +294,103 @@ int fs_create_file(const char* path, const void* data, size_t size) {
     return 0;
 }
 
+// Drop every file of a directory; virtual directories call this before
+// regenerating their contents
+void fs_clear_directory(directory_t* dir) {
+    if (!dir) return;
+    
+    for (size_t i = 0; i < dir->file_count; i++) {
+        free(dir->files[i].data);
+    }
+    dir->file_count = 0;
+}
+
+file_handle_t* fs_open_file(const char* path, int mode) {
+    if (!path) return NULL;
+    
+    char* path_copy = strdup(path);
+    char* filename = path_copy ? strrchr(path_copy, '/') : NULL;
+    if (!filename) {
+        free(path_copy);
+        return NULL;
+    }
+    *filename = '\0';
+    filename++;
+    
+    directory_t* dir = strlen(path_copy) == 0 ? fs_state.root : fs_find_directory(path_copy);
+    if (!dir || (dir->refresh && mode != 0)) {
+        free(path_copy);
+        return NULL; // Virtual files are read-only
+    }
+    if (dir->refresh) {
+        dir->refresh(dir);
+    }
+    
+    file_entry_t* file = NULL;
+    for (size_t i = 0; i < dir->file_count; i++) {
+        if (strcmp(dir->files[i].name, filename) == 0) {
+            file = &dir->files[i];
+            break;
+        }
+    }
+    free(path_copy);
+    if (!file) return NULL;
+    
+    file_handle_t* handle = calloc(1, sizeof(file_handle_t));
+    if (!handle) return NULL;
+    
+    // The next refresh frees the entry, so a virtual file is copied on open
+    handle->file = file;
+    if (dir->refresh) {
+        handle->snapshot = *file;
+        handle->snapshot.data = NULL;
+        if (file->size > 0) {
+            handle->snapshot.data = malloc(file->size);
+            if (!handle->snapshot.data) {
+                free(handle);
+                return NULL;
+            }
+            memcpy(handle->snapshot.data, file->data, file->size);
+        }
+        handle->file = &handle->snapshot;
+    }
+    handle->position = mode == 2 ? file->size : 0;
+    handle->mode = mode;
+    handle->is_open = 1;
+    return handle;
+}
+
+int fs_close_file(file_handle_t* handle) {
+    if (!handle || !handle->is_open) return -1;
+    
+    if (handle->file == &handle->snapshot) {
+        free(handle->snapshot.data);
+    }
+    handle->is_open = 0;
+    free(handle);
+    return 0;
+}
+
+size_t fs_read_file(file_handle_t* handle, void* buffer, size_t size) {
+    if (!handle || !handle->is_open || !buffer || !handle->file->data) return 0;
+    if (handle->position >= handle->file->size) return 0;
+    
+    size_t available = handle->file->size - handle->position;
+    size_t count = size < available ? size : available;
+    memcpy(buffer, (const uint8_t*)handle->file->data + handle->position, count);
+    handle->position += count;
+    return count;
+}
+
 void fs_list_directory(const char* path) {
     directory_t* dir = path ? fs_find_directory(path) : fs_state.current_dir;
     if (!dir) {
         printf("Directory not found: %s\n", path);
         return;
     }
+    if (dir->refresh) {
+        dir->refresh(dir);
+    }
     
     printf("Directory listing for %s:\n", path ? path : "current");
     
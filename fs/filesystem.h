@@ -23,6 +23,7 @@ typedef struct directory {
     size_t subdir_count;
     size_t subdir_capacity;
     struct directory* parent;
+    void (*refresh)(struct directory* dir); // Set on virtual directories, regenerates their files
 } directory_t;
 
 typedef struct {
@@ -37,6 +38,7 @@ typedef struct {
     size_t position;
     int mode; // 0=read, 1=write, 2=append
     int is_open;
+    file_entry_t snapshot; // Virtual files are read from a private copy
 } file_handle_t;
 
 // Function declarations
@@ -61,6 +63,7 @@ int fs_create_file(const char* path, const void* data, size_t size);
 int fs_file_exists(const char* path);
 size_t fs_get_file_size(const char* path);
 void fs_list_directory(const char* path);
+void fs_clear_directory(directory_t* dir);
 
 // Standard directories setup
 int fs_create_standard_dirs(void);
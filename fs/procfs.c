@@ -0,0 +1,140 @@
+#define _GNU_SOURCE
+#include "procfs.h"
+#include "filesystem.h"
+#include "../kernel/kernel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* procfs_state_name(int state) {
+    switch (state) {
+        case PROCESS_READY: return "ready";
+        case PROCESS_RUNNING: return "running";
+        case PROCESS_BLOCKED: return "blocked";
+        case PROCESS_TERMINATED: return "terminated";
+        default: return "unknown";
+    }
+}
+
+static int compare_run_time(const void* a, const void* b) {
+    uint64_t x = ((const process_stat_t*)a)->run_ns;
+    uint64_t y = ((const process_stat_t*)b)->run_ns;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+// Snapshot of every process; the caller frees it
+static process_stat_t* procfs_snapshot(size_t* count) {
+    size_t capacity = process_list_stats(NULL, 0) + 16; // Room for processes created meanwhile
+    process_stat_t* stats = malloc(capacity * sizeof(process_stat_t));
+    
+    *count = stats ? process_list_stats(stats, capacity) : 0;
+    return stats;
+}
+
+// Writes as much of the table as fits and returns its full length, like snprintf
+size_t procfs_format_top(char* buffer, size_t size) {
+    size_t count;
+    process_stat_t* stats = procfs_snapshot(&count);
+    if (!stats) return 0;
+    qsort(stats, count, sizeof(process_stat_t), compare_run_time);
+    
+    size_t length = 0;
+    char line[160];
+    uint64_t now = scheduler_now_ns();
+    for (size_t i = 0; i <= count; i++) {
+        int n;
+        if (i == 0) {
+            n = snprintf(line, sizeof(line), "%6s %-16s %-8s %3s %4s %10s %10s %8s %8s %9s\n",
+                         "PID", "NAME", "STATE", "CPU", "PRIO", "RUN_MS", "WAIT_MS",
+                         "VOL", "INVOL", "LAST_MS");
+        } else {
+            const process_stat_t* stat = &stats[i - 1];
+            double last_ms = stat->last_run_ns ? (now - stat->last_run_ns) / 1e6 : -1.0;
+            n = snprintf(line, sizeof(line), "%6u %-16.16s %-8s %3d %4d %10.3f %10.3f %8llu %8llu %9.1f\n",
+                         stat->pid, stat->name, procfs_state_name(stat->state), stat->cpu,
+                         stat->priority, stat->run_ns / 1e6, stat->wait_ns / 1e6,
+                         (unsigned long long)stat->voluntary_switches,
+                         (unsigned long long)stat->involuntary_switches, last_ms);
+        }
+        if (n < 0) break;
+        
+        if (buffer && length < size) {
+            size_t room = size - length;
+            memcpy(buffer + length, line, (size_t)n < room ? (size_t)n : room);
+        }
+        length += (size_t)n;
+    }
+    if (buffer && size > 0) {
+        buffer[length < size ? length : size - 1] = '\0';
+    }
+    
+    free(stats);
+    return length;
+}
+
+static void procfs_add_top(void) {
+    size_t length = procfs_format_top(NULL, 0);
+    char* text = malloc(length + 1);
+    if (!text) return;
+    
+    procfs_format_top(text, length + 1);
+    fs_create_file(PROCFS_PATH "/top", text, strlen(text));
+    free(text);
+}
+
+static void procfs_add_syscalls(void) {
+    syscall_stat_t stats[SYSCALL_MAX];
+    size_t count = syscall_get_stats(stats, SYSCALL_MAX);
+    char text[80 * (SYSCALL_MAX + 1)];
+    
+    size_t length = (size_t)snprintf(text, sizeof(text), "%-14s %10s %10s %10s\n",
+                                     "NAME", "CALLS", "AVG_NS", "MAX_NS");
+    for (size_t i = 0; i < count && length < sizeof(text); i++) {
+        length += (size_t)snprintf(text + length, sizeof(text) - length, "%-14s %10llu %10llu %10llu\n",
+                                   stats[i].name, (unsigned long long)stats[i].calls,
+                                   (unsigned long long)(stats[i].total_ns / stats[i].calls),
+                                   (unsigned long long)stats[i].max_ns);
+    }
+    fs_create_file(PROCFS_PATH "/syscalls", text, length < sizeof(text) ? length : sizeof(text) - 1);
+}
+
+static void procfs_add_process(const process_stat_t* stat) {
+    char path[64];
+    char text[512];
+    
+    snprintf(path, sizeof(path), PROCFS_PATH "/%u", stat->pid);
+    int n = snprintf(text, sizeof(text),
+                     "pid: %u\nname: %s\nstate: %s\ncpu: %d\npriority: %d\n"
+                     "run_ns: %llu\nwait_ns: %llu\nlast_run_ns: %llu\n"
+                     "voluntary_switches: %llu\ninvoluntary_switches: %llu\n",
+                     stat->pid, stat->name, procfs_state_name(stat->state), stat->cpu, stat->priority,
+                     (unsigned long long)stat->run_ns, (unsigned long long)stat->wait_ns,
+                     (unsigned long long)stat->last_run_ns,
+                     (unsigned long long)stat->voluntary_switches,
+                     (unsigned long long)stat->involuntary_switches);
+    if (n > 0) {
+        fs_create_file(path, text, (size_t)n < sizeof(text) ? (size_t)n : sizeof(text) - 1);
+    }
+}
+
+static void procfs_refresh(directory_t* dir) {
+    size_t count;
+    process_stat_t* stats = procfs_snapshot(&count);
+    
+    fs_clear_directory(dir);
+    procfs_add_top();
+    procfs_add_syscalls();
+    for (size_t i = 0; stats && i < count; i++) {
+        procfs_add_process(&stats[i]);
+    }
+    free(stats);
+}
+
+int procfs_init(void) {
+    directory_t* dir = fs_create_directory(PROCFS_PATH);
+    if (!dir) return -1;
+    
+    dir->refresh = procfs_refresh;
+    printf("FileSystem: Mounted process information at %s\n", PROCFS_PATH);
+    return 0;
+}
@@ -0,0 +1,17 @@
+#ifndef PROCFS_H
+#define PROCFS_H
+
+#include <stddef.h>
+
+// /proc: a virtual directory regenerated from scheduler accounting each
+// time it is listed or a file in it is opened.
+//   /proc/top       one line per process, busiest first
+//   /proc/syscalls  calls and latency of each system call made so far
+//   /proc/<pid>     accounting of one process
+#define PROCFS_PATH "/proc"
+
+// Function declarations
+int procfs_init(void);
+size_t procfs_format_top(char* buffer, size_t size);
+
+#endif // PROCFS_H
@@ -5,6 +5,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <time.h>
 
 static gui_manager_t gui_mgr = {0};
 
@@ -12,6 +14,47 @@ static gui_manager_t gui_mgr = {0};
 static char screen_buffer[80 * 25]; // 80x25 text mode simulation
 static color_t color_buffer[80 * 25];
 
+static uint64_t gui_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ull + (uint64_t)ts.tv_nsec / 1000000ull;
+}
+
+static void gui_tick_expired(void* arg) {
+    (void)arg;
+    gui_mgr.pending |= EVLOOP_TIMER;
+    timer_wheel_add(&gui_mgr.timers, &gui_mgr.tick_timer, gui_now_ms() + gui_mgr.tick_interval);
+}
+
+static void gui_paint_expired(void* arg) {
+    (void)arg;
+    gui_mgr.pending |= EVLOOP_WAKE;
+}
+
+#ifdef STANDALONE_APP
+// Tell the desktop what this app is doing, if it launched us
+static void gui_notify_desktop(const char* what) {
+    if (!gui_mgr.apps_channel) return;
+    
+    char message[256];
+    int length = snprintf(message, sizeof(message), "%s %s", program_invocation_short_name, what);
+    if (length > 0) {
+        ipc_channel_send(gui_mgr.apps_channel, message, (size_t)length + 1);
+    }
+}
+#else
+static void gui_receive_app_messages(void) {
+    char message[256];
+    size_t length;
+    
+    while (gui_mgr.apps_channel &&
+           ipc_channel_receive(gui_mgr.apps_channel, message, sizeof(message) - 1, &length) == 0) {
+        message[length < sizeof(message) - 1 ? length : sizeof(message) - 1] = '\0';
+        printf("GUI: Message from app: %s\n", message);
+    }
+}
+#endif
+
 int gui_init(mindose_config_t* config) {
     printf("GUI: Initializing Windows 3.1-like interface...\n");
     
@@ -35,8 +78,36 @@ int gui_init(mindose_config_t* config) {
     gui_mgr.desktop->bg_color = gui_mgr.desktop_color;
     gui_mgr.windows = NULL;
     gui_mgr.active_window = NULL;
+    
+    // Events come from the keyboard, a timer and repaint requests only
+    if (evloop_init(&gui_mgr.loop) != 0) {
+        gui_destroy_widget(gui_mgr.desktop);
+        gui_mgr.desktop = NULL;
+        return -1;
+    }
+    gui_mgr.input_fd = -1;
+    if (isatty(STDIN_FILENO) && evloop_watch(&gui_mgr.loop, STDIN_FILENO) == 0) {
+        gui_mgr.input_fd = STDIN_FILENO;
+    }
+    gui_mgr.pending = 0;
+    timer_wheel_init(&gui_mgr.timers, gui_now_ms());
+    wheel_timer_init(&gui_mgr.tick_timer, gui_tick_expired, NULL);
+    wheel_timer_init(&gui_mgr.paint_timer, gui_paint_expired, NULL);
+    gui_mgr.tick_interval = 0;
+    gui_mgr.key_start = 0;
+    gui_mgr.key_count = 0;
     gui_mgr.initialized = 1;
     
+    #ifdef STANDALONE_APP
+    // Only there when the desktop launched us; an app started by hand has none
+    char channel_name[IPC_NAME_MAX];
+    snprintf(channel_name, sizeof(channel_name), IPC_APPS_CHANNEL, (int)getppid());
+    gui_mgr.apps_channel = ipc_channel_open(channel_name);
+    gui_notify_desktop("started");
+    #else
+    gui_mgr.apps_channel = NULL; // Attached by gui_main_loop
+    #endif
+    
     printf("GUI: Initialized (%dx%d)\n", gui_mgr.screen_width, gui_mgr.screen_height);
     return 0;
 }
@@ -60,6 +131,14 @@ void gui_cleanup(void) {
         gui_mgr.desktop = NULL;
     }
     
+    #ifdef STANDALONE_APP
+    gui_notify_desktop("exiting");
+    ipc_channel_close(gui_mgr.apps_channel);
+    #endif
+    gui_mgr.apps_channel = NULL;
+    
+    evloop_destroy(&gui_mgr.loop);
+    gui_mgr.input_fd = -1;
     gui_mgr.initialized = 0;
 }
 
@@ -103,7 +182,17 @@ void gui_main_loop(void) {
     // Main event loop
     event_t event;
     int running = 1;
-    int frame_count = 0;
+    
+    // Exit after demonstration, ~5 seconds
+    gui_set_timer(5000);
+    
+    #ifndef STANDALONE_APP
+    // Apps launched from here report over the app loader's channel
+    gui_mgr.apps_channel = app_loader_channel();
+    if (gui_mgr.apps_channel) {
+        evloop_watch(&gui_mgr.loop, ipc_channel_fd(gui_mgr.apps_channel));
+    }
+    #endif
     
     while (running) {
         // Poll for events
@@ -112,22 +201,28 @@ void gui_main_loop(void) {
             
             if (event.type == EVENT_WINDOW_CLOSE) {
                 running = 0;
+            } else if (event.type == EVENT_TIMER) {
+                printf("GUI: Demo complete, exiting main loop\n");
+                running = 0;
             }
         }
         
         // Redraw screen
         gui_refresh_screen();
         
-        // Simulate frame rate
-        usleep(50000); // 50ms = ~20 FPS
-        frame_count++;
-        
-        // Exit after demonstration
-        if (frame_count > 100) { // Run for ~5 seconds
-            printf("GUI: Demo complete, exiting main loop\n");
-            running = 0;
+        // Sleep until input, a timer or a repaint request
+        if (running) {
+            gui_wait(-1);
         }
     }
+    gui_set_timer(0);
+    
+    #ifndef STANDALONE_APP
+    if (gui_mgr.apps_channel) {
+        evloop_unwatch(&gui_mgr.loop, ipc_channel_fd(gui_mgr.apps_channel));
+        gui_mgr.apps_channel = NULL;
+    }
+    #endif
 }
 
 window_t* gui_create_window(const char* title, int x, int y, int width, int height) {
@@ -457,20 +552,119 @@ void gui_refresh_screen(void) {
     fflush(stdout);
 }
 
+// Point the loop's timerfd at the earliest wheel timer, one-shot
+static void gui_arm_timers(void) {
+    uint64_t next = timer_wheel_next(&gui_mgr.timers);
+    if (next == TIMER_WHEEL_NONE) {
+        evloop_set_timer(&gui_mgr.loop, 0, 0);
+        return;
+    }
+    
+    uint64_t now = gui_now_ms();
+    uint64_t delay = next > now ? next - now : 1; // 0 would disarm it
+    evloop_set_timer(&gui_mgr.loop, delay > UINT32_MAX ? UINT32_MAX : (unsigned)delay, 0);
+}
+
+// Move whatever the event sources have ready into the pending state
+static void gui_collect_events(int timeout_ms) {
+    #ifndef STANDALONE_APP
+    // Sleep only if no app message is queued; the next one rings the doorbell
+    if (gui_mgr.apps_channel && timeout_ms != 0 && ipc_channel_arm(gui_mgr.apps_channel) != 0) {
+        timeout_ms = 0;
+    }
+    #endif
+    int input_fd = -1;
+    int sources = evloop_wait(&gui_mgr.loop, timeout_ms, &input_fd);
+    #ifndef STANDALONE_APP
+    gui_receive_app_messages();
+    #endif
+    if (sources <= 0) return;
+    
+    if (sources & EVLOOP_TIMER) {
+        timer_wheel_run(timer_wheel_advance(&gui_mgr.timers, gui_now_ms()));
+        gui_arm_timers();
+    }
+    gui_mgr.pending |= sources & EVLOOP_WAKE;
+    if ((sources & EVLOOP_INPUT) && input_fd == gui_mgr.input_fd && gui_mgr.key_count == 0) {
+        ssize_t count = read(input_fd, gui_mgr.keys, sizeof(gui_mgr.keys));
+        if (count > 0) {
+            gui_mgr.key_start = 0;
+            gui_mgr.key_count = (size_t)count;
+        } else if (count == 0 || errno != EAGAIN) {
+            // End of input: stop watching rather than wake on it forever
+            evloop_unwatch(&gui_mgr.loop, input_fd);
+            gui_mgr.input_fd = -1;
+        }
+    }
+}
+
+// Returns the next pending event without blocking
 int gui_poll_event(event_t* event) {
-    // Simulate events for demonstration
-    static int event_counter = 0;
-    event_counter++;
+    if (!gui_mgr.pending && !gui_mgr.key_count) {
+        gui_collect_events(0);
+    }
     
-    if (event_counter % 50 == 0) {
+    if (gui_mgr.pending & EVLOOP_WAKE) {
+        gui_mgr.pending &= ~EVLOOP_WAKE;
         event->type = EVENT_PAINT;
         return 1;
     }
+    if (gui_mgr.pending & EVLOOP_TIMER) {
+        gui_mgr.pending &= ~EVLOOP_TIMER;
+        event->type = EVENT_TIMER;
+        return 1;
+    }
+    if (gui_mgr.key_count) {
+        event->type = EVENT_KEY_PRESS;
+        event->data.key.key_code = gui_mgr.keys[gui_mgr.key_start++];
+        event->data.key.modifiers = 0;
+        gui_mgr.key_count--;
+        return 1;
+    }
     
     event->type = EVENT_NONE;
     return 0;
 }
 
+// Block until an event is pending or timeout_ms passes (-1 waits forever);
+// returns 1 if one is pending. An idle loop sleeps here instead of polling.
+int gui_wait(int timeout_ms) {
+    if (!gui_mgr.pending && !gui_mgr.key_count) {
+        gui_collect_events(timeout_ms);
+    }
+    return gui_mgr.pending || gui_mgr.key_count ? 1 : 0;
+}
+
+// Deliver EVENT_TIMER every interval_ms; 0 stops the timer
+int gui_set_timer(unsigned interval_ms) {
+    if (!gui_mgr.initialized) return -1;
+    
+    gui_mgr.tick_interval = interval_ms;
+    if (interval_ms) {
+        timer_wheel_add(&gui_mgr.timers, &gui_mgr.tick_timer, gui_now_ms() + interval_ms);
+    } else {
+        timer_wheel_cancel(&gui_mgr.timers, &gui_mgr.tick_timer);
+    }
+    gui_arm_timers();
+    return 0;
+}
+
+// Ask for a repaint; safe from other threads and signal handlers
+void gui_invalidate(void) {
+    evloop_wake(&gui_mgr.loop);
+}
+
+// Ask for a repaint within delay_ms. Requests coalesce: one already due
+// sooner covers this one, so bursts of updates cost a single redraw.
+void gui_invalidate_in(unsigned delay_ms) {
+    if (!gui_mgr.initialized) return;
+    
+    uint64_t expires = gui_now_ms() + delay_ms;
+    if (wheel_timer_pending(&gui_mgr.paint_timer) && gui_mgr.paint_timer.expires <= expires) return;
+    timer_wheel_add(&gui_mgr.timers, &gui_mgr.paint_timer, expires);
+    gui_arm_timers();
+}
+
 void gui_launch_app_handler(widget_t* widget, int x, int y) {
     (void)x; (void)y; // Suppress unused parameter warnings
     
@@ -4,6 +4,9 @@
 #include <stdint.h>
 #include <stddef.h>
 #include "../common.h"
+#include "../kernel/evloop.h"
+#include "../kernel/timerwheel.h"
+#include "../kernel/ipc.h"
 
 // Color definitions (Windows 3.1 style)
 typedef enum {
@@ -41,7 +44,8 @@ typedef enum {
     EVENT_MOUSE_RELEASE,
     EVENT_WINDOW_CLOSE,
     EVENT_WINDOW_RESIZE,
-    EVENT_PAINT
+    EVENT_PAINT,
+    EVENT_TIMER
 } event_type_t;
 
 // Event structure
@@ -109,6 +113,17 @@ typedef struct {
     int screen_height;
     color_t desktop_color;
     int initialized;
+    evloop_t loop;           // Event sources; idle loops sleep in here
+    int input_fd;            // Read for key presses, -1 for none
+    int pending;             // EVLOOP_TIMER and EVLOOP_WAKE not yet returned as events
+    timer_wheel_t timers;    // 1 ms ticks; the loop's timerfd fires at the next expiry
+    wheel_timer_t tick_timer;  // gui_set_timer
+    unsigned tick_interval;
+    wheel_timer_t paint_timer; // gui_invalidate_in
+    ipc_channel_t* apps_channel; // Desktop: messages from apps; app: sends to the desktop
+    unsigned char keys[64];  // Key presses read but not yet returned
+    size_t key_start;
+    size_t key_count;
 } gui_manager_t;
 
 // Function declarations
@@ -144,6 +159,10 @@ void gui_refresh_screen(void);
 
 // Event handling
 int gui_poll_event(event_t* event);
+int gui_wait(int timeout_ms);
+int gui_set_timer(unsigned interval_ms);
+void gui_invalidate(void);
+void gui_invalidate_in(unsigned delay_ms);
 void gui_handle_event(event_t* event);
 void gui_dispatch_event(widget_t* widget, event_t* event);
 
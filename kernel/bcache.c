@@ -0,0 +1,327 @@
+#define _GNU_SOURCE
+#include "bcache.h"
+#include "kernel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Hash index
+static bcache_buffer_t** bcache_bucket(buffer_cache_t* cache, uint64_t block) {
+    return &cache->buckets[(block * 0x9e3779b97f4a7c15ull >> 32) & cache->bucket_mask];
+}
+
+static bcache_buffer_t* bcache_lookup(buffer_cache_t* cache, uint64_t block) {
+    bcache_buffer_t* buffer = *bcache_bucket(cache, block);
+    while (buffer && buffer->block != block) {
+        buffer = buffer->hash_next;
+    }
+    return buffer;
+}
+
+static void bcache_hash_remove(buffer_cache_t* cache, bcache_buffer_t* buffer) {
+    bcache_buffer_t** link = bcache_bucket(cache, buffer->block);
+    while (*link && *link != buffer) {
+        link = &(*link)->hash_next;
+    }
+    if (*link) {
+        *link = buffer->hash_next;
+    }
+    buffer->hash_next = NULL;
+}
+
+// Queues
+static bcache_queue_t* bcache_queue(buffer_cache_t* cache, uint8_t queue) {
+    switch (queue) {
+        case BCACHE_A1IN: return &cache->a1in;
+        case BCACHE_AM: return &cache->am;
+        case BCACHE_A1OUT: return &cache->a1out;
+        default: return NULL;
+    }
+}
+
+static void bcache_push(buffer_cache_t* cache, bcache_buffer_t* buffer, uint8_t queue) {
+    bcache_queue_t* list = bcache_queue(cache, queue);
+    buffer->queue = queue;
+    buffer->prev = NULL;
+    buffer->next = list->head;
+    if (list->head) {
+        list->head->prev = buffer;
+    } else {
+        list->tail = buffer;
+    }
+    list->head = buffer;
+    list->count++;
+}
+
+static void bcache_unlink(buffer_cache_t* cache, bcache_buffer_t* buffer) {
+    bcache_queue_t* list = bcache_queue(cache, buffer->queue);
+    if (!list) return;
+    
+    if (buffer->prev) {
+        buffer->prev->next = buffer->next;
+    } else {
+        list->head = buffer->next;
+    }
+    if (buffer->next) {
+        buffer->next->prev = buffer->prev;
+    } else {
+        list->tail = buffer->prev;
+    }
+    buffer->prev = NULL;
+    buffer->next = NULL;
+    buffer->queue = BCACHE_FREE;
+    list->count--;
+}
+
+// Forget a block altogether and recycle its header
+static void bcache_forget(buffer_cache_t* cache, bcache_buffer_t* buffer) {
+    bcache_unlink(cache, buffer);
+    bcache_hash_remove(cache, buffer);
+    buffer->next = cache->free_list;
+    cache->free_list = buffer;
+}
+
+static int bcache_writeback(buffer_cache_t* cache, bcache_buffer_t* buffer) {
+    if (!buffer->dirty) return 0;
+    if (block_write(cache->device, buffer->block, buffer->data, 1) != 0) return -1;
+    
+    buffer->dirty = 0;
+    cache->writebacks++;
+    return 0;
+}
+
+// Oldest buffer on a queue that is unpinned and clean, or can be made clean
+static bcache_buffer_t* bcache_victim(buffer_cache_t* cache, bcache_queue_t* list) {
+    bcache_buffer_t* victim = list->tail;
+    while (victim && (victim->pins || bcache_writeback(cache, victim) != 0)) {
+        victim = victim->prev;
+    }
+    return victim;
+}
+
+// Take the data page of an old buffer. A1in goes first while it is over
+// its share, so blocks read once leave before hot ones; they are
+// remembered as ghosts, while blocks leaving Am are forgotten.
+static uint8_t* bcache_reclaim(buffer_cache_t* cache) {
+    for (;;) {
+        int from_in = cache->a1in.count > cache->in_target || cache->am.count == 0;
+        bcache_buffer_t* victim = bcache_victim(cache, from_in ? &cache->a1in : &cache->am);
+        if (!victim) {
+            from_in = !from_in;
+            victim = bcache_victim(cache, from_in ? &cache->a1in : &cache->am);
+        }
+        if (!victim) return NULL;
+        
+        // Used again on its way through A1in: hot after all
+        if (from_in && victim->referenced) {
+            victim->referenced = 0;
+            bcache_unlink(cache, victim);
+            bcache_push(cache, victim, BCACHE_AM);
+            cache->promotions++;
+            continue;
+        }
+        
+        uint8_t* data = victim->data;
+        victim->data = NULL;
+        cache->evictions++;
+        if (from_in) {
+            bcache_unlink(cache, victim);
+            bcache_push(cache, victim, BCACHE_A1OUT);
+            if (cache->a1out.count > cache->out_target) {
+                bcache_forget(cache, cache->a1out.tail);
+            }
+        } else {
+            bcache_forget(cache, victim);
+        }
+        return data;
+    }
+}
+
+int bcache_init(buffer_cache_t* cache, block_device_t* device, size_t bytes) {
+    if (!cache || !device || !device->base) return -1;
+    
+    memset(cache, 0, sizeof(*cache));
+    size_t capacity = bytes / BLOCK_SIZE;
+    if (capacity < BCACHE_MIN_BUFFERS) {
+        capacity = BCACHE_MIN_BUFFERS;
+    }
+    if (capacity > device->block_count) {
+        capacity = (size_t)device->block_count;
+    }
+    
+    cache->device = device;
+    cache->capacity = capacity;
+    cache->in_target = capacity / BCACHE_IN_SHARE ? capacity / BCACHE_IN_SHARE : 1;
+    cache->out_target = capacity / BCACHE_OUT_SHARE ? capacity / BCACHE_OUT_SHARE : 1;
+    
+    size_t headers = capacity + cache->out_target;
+    size_t buckets = 64;
+    while (buckets < headers) {
+        buckets <<= 1;
+    }
+    cache->buffers = calloc(headers, sizeof(bcache_buffer_t));
+    cache->buckets = calloc(buckets, sizeof(bcache_buffer_t*));
+    if (!cache->buffers || !cache->buckets) {
+        free(cache->buffers);
+        free(cache->buckets);
+        memset(cache, 0, sizeof(*cache));
+        return -1;
+    }
+    cache->bucket_mask = buckets - 1;
+    for (size_t i = headers; i > 0; i--) {
+        cache->buffers[i - 1].next = cache->free_list;
+        cache->free_list = &cache->buffers[i - 1];
+    }
+    
+    // Data pages come from the arena as the cache fills
+    printf("Bcache: %zu buffers (%zu KB), 2Q with %zu in A1in and %zu ghosts\n",
+           capacity, capacity * BLOCK_SIZE / 1024, cache->in_target, cache->out_target);
+    return 0;
+}
+
+void bcache_destroy(buffer_cache_t* cache) {
+    if (!cache || !cache->buffers) return;
+    
+    bcache_sync(cache);
+    size_t headers = cache->capacity + cache->out_target;
+    for (size_t i = 0; i < headers; i++) {
+        if (cache->buffers[i].data) {
+            memory_free(cache->buffers[i].data);
+        }
+    }
+    free(cache->buffers);
+    free(cache->buckets);
+    memset(cache, 0, sizeof(*cache));
+}
+
+// Find or read a block and pin it; NULL if the block is out of range or
+// every buffer is pinned
+bcache_buffer_t* bcache_get(buffer_cache_t* cache, uint64_t block) {
+    if (!cache || !cache->buffers) return NULL;
+    
+    kernel_enter();
+    bcache_buffer_t* buffer = bcache_lookup(cache, block);
+    if (buffer && buffer->data) {
+        // A1in stays in arrival order; the block is promoted if the
+        // reference is still there when it reaches the end
+        if (buffer->queue == BCACHE_AM) {
+            bcache_unlink(cache, buffer);
+            bcache_push(cache, buffer, BCACHE_AM);
+        } else {
+            buffer->referenced = 1;
+        }
+        buffer->pins++;
+        cache->hits++;
+        kernel_leave();
+        return buffer;
+    }
+    
+    const uint8_t* source = block_read(cache->device, block, 1);
+    if (!source) {
+        kernel_leave();
+        return NULL;
+    }
+    cache->misses++;
+    
+    // A ghost means the block was read recently enough to count as hot
+    uint8_t queue = BCACHE_A1IN;
+    if (buffer) {
+        bcache_forget(cache, buffer);
+        cache->ghost_hits++;
+        queue = BCACHE_AM;
+    }
+    
+    uint8_t* data = NULL;
+    if (cache->allocated < cache->capacity) {
+        data = memory_alloc(BLOCK_SIZE);
+        if (data) cache->allocated++;
+    }
+    if (!data) {
+        data = bcache_reclaim(cache);
+    }
+    if (!data) {
+        kernel_leave();
+        return NULL;
+    }
+    
+    buffer = cache->free_list;
+    cache->free_list = buffer->next;
+    memcpy(data, source, BLOCK_SIZE);
+    buffer->block = block;
+    buffer->data = data;
+    buffer->pins = 1;
+    buffer->dirty = 0;
+    buffer->referenced = 0;
+    bcache_buffer_t** bucket = bcache_bucket(cache, block);
+    buffer->hash_next = *bucket;
+    *bucket = buffer;
+    bcache_push(cache, buffer, queue);
+    kernel_leave();
+    return buffer;
+}
+
+void bcache_release(buffer_cache_t* cache, bcache_buffer_t* buffer) {
+    if (!cache || !buffer) return;
+    
+    kernel_enter();
+    if (buffer->pins) {
+        buffer->pins--;
+    }
+    kernel_leave();
+}
+
+// The caller changed a pinned buffer; it reaches the device on eviction
+// or the next bcache_sync
+void bcache_mark_dirty(buffer_cache_t* cache, bcache_buffer_t* buffer) {
+    if (!cache || !buffer || !buffer->data) return;
+    
+    kernel_enter();
+    buffer->dirty = 1;
+    kernel_leave();
+}
+
+// Write back every dirty buffer, then flush the device
+int bcache_sync(buffer_cache_t* cache) {
+    if (!cache || !cache->buffers) return -1;
+    
+    kernel_enter();
+    int result = 0;
+    size_t headers = cache->capacity + cache->out_target;
+    for (size_t i = 0; i < headers; i++) {
+        bcache_buffer_t* buffer = &cache->buffers[i];
+        if (buffer->data && bcache_writeback(cache, buffer) != 0) {
+            result = -1;
+        }
+    }
+    if (block_sync(cache->device) != 0) {
+        result = -1;
+    }
+    kernel_leave();
+    return result;
+}
+
+void bcache_get_stats(buffer_cache_t* cache, bcache_stats_t* stats) {
+    if (!stats) return;
+    
+    memset(stats, 0, sizeof(*stats));
+    if (!cache || !cache->buffers) return;
+    
+    kernel_enter();
+    stats->capacity = cache->capacity;
+    stats->resident = cache->a1in.count + cache->am.count;
+    stats->hot = cache->am.count;
+    stats->ghosts = cache->a1out.count;
+    size_t headers = cache->capacity + cache->out_target;
+    for (size_t i = 0; i < headers; i++) {
+        if (!cache->buffers[i].data) continue;
+        if (cache->buffers[i].dirty) stats->dirty++;
+        if (cache->buffers[i].pins) stats->pinned++;
+    }
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->ghost_hits = cache->ghost_hits;
+    stats->promotions = cache->promotions;
+    stats->evictions = cache->evictions;
+    stats->writebacks = cache->writebacks;
+    kernel_leave();
+}
@@ -0,0 +1,93 @@
+#ifndef BCACHE_H
+#define BCACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "block.h"
+
+// Buffer cache of whole blocks over a block device, sized as a share of
+// --mem and backed by arena pages. Replacement is 2Q: new blocks wait in a
+// FIFO (A1in) and only join the LRU of hot blocks (Am) if they were used
+// again before reaching its end, or come back while their number is still
+// remembered in the ghost queue (A1out). A long sequential scan therefore
+// cycles through A1in without flushing the hot set. Pinned buffers are
+// never evicted; dirty ones are written back when evicted or synced.
+#define BCACHE_DEFAULT_PERCENT 5  // Of --mem
+#define BCACHE_MAX_PERCENT     50 // The rest of the arena is left to processes
+#define BCACHE_DISABLED        -1 // bcache_percent for no cache at all
+#define BCACHE_MIN_BUFFERS     16
+#define BCACHE_IN_SHARE        4  // A1in holds a quarter of the buffers
+#define BCACHE_OUT_SHARE       2  // Ghosts for half as many blocks as fit
+
+// Queues a buffer header can be on
+#define BCACHE_FREE  0
+#define BCACHE_A1IN  1
+#define BCACHE_AM    2
+#define BCACHE_A1OUT 3 // Ghost: the block number only, no data
+
+typedef struct bcache_buffer {
+    uint64_t block;
+    uint8_t* data;   // BLOCK_SIZE bytes, NULL for ghosts
+    uint32_t pins;
+    uint8_t queue;
+    uint8_t dirty;
+    uint8_t referenced; // Hit while in A1in
+    struct bcache_buffer* hash_next;
+    struct bcache_buffer* prev; // Queue links, newest at the head
+    struct bcache_buffer* next;
+} bcache_buffer_t;
+
+typedef struct {
+    bcache_buffer_t* head;
+    bcache_buffer_t* tail;
+    size_t count;
+} bcache_queue_t;
+
+typedef struct {
+    block_device_t* device;
+    bcache_buffer_t* buffers;  // Headers for every resident block and ghost
+    bcache_buffer_t* free_list;
+    bcache_buffer_t** buckets;
+    size_t bucket_mask;
+    size_t capacity;   // Resident blocks at most
+    size_t allocated;  // Data pages taken from the arena so far
+    size_t in_target;  // A1in gives up buffers once it holds more
+    size_t out_target;
+    bcache_queue_t a1in;
+    bcache_queue_t am;
+    bcache_queue_t a1out;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t ghost_hits; // Misses on remembered blocks, promoted to Am
+    uint64_t promotions; // Referenced blocks moved from A1in to Am
+    uint64_t evictions;
+    uint64_t writebacks;
+} buffer_cache_t;
+
+typedef struct {
+    size_t capacity;
+    size_t resident;
+    size_t hot;    // In Am
+    size_t ghosts;
+    size_t dirty;
+    size_t pinned;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t ghost_hits;
+    uint64_t promotions;
+    uint64_t evictions;
+    uint64_t writebacks;
+} bcache_stats_t;
+
+// Function declarations
+int bcache_init(buffer_cache_t* cache, block_device_t* device, size_t bytes);
+void bcache_destroy(buffer_cache_t* cache);
+
+// A buffer from bcache_get stays pinned until bcache_release
+bcache_buffer_t* bcache_get(buffer_cache_t* cache, uint64_t block);
+void bcache_release(buffer_cache_t* cache, bcache_buffer_t* buffer);
+void bcache_mark_dirty(buffer_cache_t* cache, bcache_buffer_t* buffer);
+int bcache_sync(buffer_cache_t* cache);
+void bcache_get_stats(buffer_cache_t* cache, bcache_stats_t* stats);
+
+#endif // BCACHE_H
@@ -0,0 +1,170 @@
+#define _GNU_SOURCE
+#include "block.h"
+#include "kernel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define BLOCK_BITS 64 // Blocks per dirty bitmap word
+
+int block_open(block_device_t* device, const char* path) {
+    if (!device || !path) return -1;
+    
+    memset(device, 0, sizeof(*device));
+    device->fd = open(path, O_RDWR);
+    device->writable = 1;
+    if (device->fd < 0 && (errno == EACCES || errno == EROFS)) {
+        device->fd = open(path, O_RDONLY);
+        device->writable = 0;
+    }
+    
+    struct stat st;
+    if (device->fd < 0 || fstat(device->fd, &st) != 0) {
+        if (device->fd >= 0) close(device->fd);
+        device->fd = -1;
+        return -1;
+    }
+    
+    // Leave the swap area to paging, which reaches it with pread and pwrite
+    uint64_t swap = ((uint64_t)st.st_size / PAGING_SWAP_FRACTION) & ~(uint64_t)(PAGING_PAGE_SIZE - 1);
+    device->block_count = ((uint64_t)st.st_size - swap) / BLOCK_SIZE;
+    device->size = device->block_count * BLOCK_SIZE;
+    if (device->block_count == 0 || device->size > SIZE_MAX) {
+        close(device->fd);
+        device->fd = -1;
+        return -1;
+    }
+    
+    int prot = PROT_READ | (device->writable ? PROT_WRITE : 0);
+    void* base = mmap(NULL, (size_t)device->size, prot, MAP_SHARED, device->fd, 0);
+    size_t words = (size_t)((device->block_count + BLOCK_BITS - 1) / BLOCK_BITS);
+    device->dirty = calloc(words, sizeof(uint64_t));
+    if (base == MAP_FAILED || !device->dirty) {
+        if (base != MAP_FAILED) munmap(base, (size_t)device->size);
+        free(device->dirty);
+        device->dirty = NULL;
+        close(device->fd);
+        device->fd = -1;
+        return -1;
+    }
+    device->base = base;
+    
+    printf("Block: %llu blocks of %d bytes in %s%s\n", (unsigned long long)device->block_count,
+           BLOCK_SIZE, path, device->writable ? "" : " (read-only)");
+    return 0;
+}
+
+void block_close(block_device_t* device) {
+    if (!device || !device->base) return;
+    
+    block_sync(device);
+    munmap(device->base, (size_t)device->size);
+    free(device->dirty);
+    close(device->fd);
+    device->base = NULL;
+    device->dirty = NULL;
+    device->fd = -1;
+}
+
+// Zero-copy: count blocks starting at block, straight from the mapping
+const void* block_read(block_device_t* device, uint64_t block, size_t count) {
+    if (!device || !device->base || count == 0 ||
+        block >= device->block_count || count > device->block_count - block) {
+        return NULL;
+    }
+    
+    __atomic_fetch_add(&device->reads, 1, __ATOMIC_RELAXED);
+    return device->base + block * BLOCK_SIZE;
+}
+
+int block_write(block_device_t* device, uint64_t block, const void* data, size_t count) {
+    if (!device || !device->base || !device->writable || !data || count == 0 ||
+        block >= device->block_count || count > device->block_count - block) {
+        return -1;
+    }
+    
+    kernel_enter();
+    memcpy(device->base + block * BLOCK_SIZE, data, count * BLOCK_SIZE);
+    for (uint64_t i = block; i < block + count; i++) {
+        uint64_t bit = (uint64_t)1 << (i % BLOCK_BITS);
+        if (!(device->dirty[i / BLOCK_BITS] & bit)) {
+            device->dirty[i / BLOCK_BITS] |= bit;
+            device->dirty_count++;
+        }
+    }
+    device->writes++;
+    
+    int result = 0;
+    if (device->dirty_count >= BLOCK_SYNC_BATCH) {
+        result = block_sync(device);
+    }
+    kernel_leave();
+    return result;
+}
+
+// Flush one contiguous run of dirty blocks; msync wants host page alignment
+static int block_sync_run(block_device_t* device, uint64_t first, uint64_t count) {
+    uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t start = (first * BLOCK_SIZE) & ~(page - 1);
+    uint64_t end = (first + count) * BLOCK_SIZE;
+    
+    if (msync(device->base + start, (size_t)(end - start), MS_SYNC) != 0) return -1;
+    
+    for (uint64_t i = first; i < first + count; i++) {
+        device->dirty[i / BLOCK_BITS] &= ~((uint64_t)1 << (i % BLOCK_BITS));
+    }
+    device->dirty_count -= count;
+    device->syncs++;
+    device->synced_blocks += count;
+    return 0;
+}
+
+// Write every dirty block back to the image; blocks that fail stay dirty
+int block_sync(block_device_t* device) {
+    if (!device || !device->base) return -1;
+    
+    kernel_enter();
+    int result = 0;
+    uint64_t run = 0;
+    uint64_t run_length = 0;
+    size_t words = (size_t)((device->block_count + BLOCK_BITS - 1) / BLOCK_BITS);
+    for (size_t word = 0; word < words && device->dirty_count; word++) {
+        uint64_t bits = device->dirty[word];
+        if (!bits && !run_length) continue;
+        
+        for (uint64_t i = 0; i < BLOCK_BITS; i++) {
+            uint64_t block = (uint64_t)word * BLOCK_BITS + i;
+            if (bits & ((uint64_t)1 << i)) {
+                if (!run_length) run = block;
+                run_length++;
+            } else if (run_length) {
+                if (block_sync_run(device, run, run_length) != 0) result = -1;
+                run_length = 0;
+            }
+        }
+    }
+    if (run_length && block_sync_run(device, run, run_length) != 0) {
+        result = -1;
+    }
+    kernel_leave();
+    return result;
+}
+
+void block_get_stats(const block_device_t* device, block_stats_t* stats) {
+    if (!stats) return;
+    
+    memset(stats, 0, sizeof(*stats));
+    if (!device || !device->base) return;
+    
+    stats->block_count = device->block_count;
+    stats->reads = __atomic_load_n(&device->reads, __ATOMIC_RELAXED);
+    stats->writes = device->writes;
+    stats->dirty_blocks = device->dirty_count;
+    stats->syncs = device->syncs;
+    stats->synced_blocks = device->synced_blocks;
+}
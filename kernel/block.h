@@ -0,0 +1,49 @@
+#ifndef BLOCK_H
+#define BLOCK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Block device over the disk image. The image is mapped shared, so reads
+// hand out pointers into the mapping instead of copying, and writes land
+// in the host page cache at once. Dirty blocks are tracked in a bitmap and
+// flushed together, one msync per contiguous run, once BLOCK_SYNC_BATCH of
+// them have piled up or on block_sync. The device ends where the swap area
+// in the last quarter of the image begins.
+#define BLOCK_SIZE       4096
+#define BLOCK_SYNC_BATCH 64 // Dirty blocks that trigger a flush
+
+typedef struct {
+    int fd;
+    uint8_t* base;       // Start of the mapping, NULL while closed
+    uint64_t size;       // Mapped bytes
+    uint64_t block_count;
+    int writable;        // Read-only images still serve reads
+    uint64_t* dirty;     // One bit per block
+    uint64_t dirty_count;
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t syncs;          // msync calls
+    uint64_t synced_blocks;
+} block_device_t;
+
+typedef struct {
+    uint64_t block_count;
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t dirty_blocks;
+    uint64_t syncs;
+    uint64_t synced_blocks;
+} block_stats_t;
+
+// Function declarations
+int block_open(block_device_t* device, const char* path);
+void block_close(block_device_t* device);
+
+// Block I/O; a read stays valid until the device is closed
+const void* block_read(block_device_t* device, uint64_t block, size_t count);
+int block_write(block_device_t* device, uint64_t block, const void* data, size_t count);
+int block_sync(block_device_t* device);
+void block_get_stats(const block_device_t* device, block_stats_t* stats);
+
+#endif // BLOCK_H
@@ -0,0 +1,119 @@
+#define _GNU_SOURCE
+#include "evloop.h"
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+int evloop_init(evloop_t* loop) {
+    if (!loop) return -1;
+    
+    loop->watch_count = 0;
+    loop->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    loop->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (loop->timer_fd < 0 || loop->wake_fd < 0) {
+        evloop_destroy(loop);
+        return -1;
+    }
+    return 0;
+}
+
+void evloop_destroy(evloop_t* loop) {
+    if (!loop) return;
+    
+    if (loop->timer_fd >= 0) {
+        close(loop->timer_fd);
+        loop->timer_fd = -1;
+    }
+    if (loop->wake_fd >= 0) {
+        close(loop->wake_fd);
+        loop->wake_fd = -1;
+    }
+    loop->watch_count = 0;
+}
+
+// Fires first_ms from now, then every interval_ms; interval 0 fires once and
+// first_ms 0 disarms
+int evloop_set_timer(evloop_t* loop, unsigned first_ms, unsigned interval_ms) {
+    if (!loop || loop->timer_fd < 0) return -1;
+    
+    struct itimerspec spec;
+    spec.it_value.tv_sec = first_ms / 1000;
+    spec.it_value.tv_nsec = (long)(first_ms % 1000) * 1000000L;
+    spec.it_interval.tv_sec = interval_ms / 1000;
+    spec.it_interval.tv_nsec = (long)(interval_ms % 1000) * 1000000L;
+    return timerfd_settime(loop->timer_fd, 0, &spec, NULL) == 0 ? 0 : -1;
+}
+
+int evloop_watch(evloop_t* loop, int fd) {
+    if (!loop || fd < 0 || loop->watch_count >= EVLOOP_MAX_WATCH) return -1;
+    
+    loop->watch_fds[loop->watch_count++] = fd;
+    return 0;
+}
+
+int evloop_unwatch(evloop_t* loop, int fd) {
+    if (!loop) return -1;
+    
+    for (size_t i = 0; i < loop->watch_count; i++) {
+        if (loop->watch_fds[i] == fd) {
+            loop->watch_fds[i] = loop->watch_fds[--loop->watch_count];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Safe from any thread and from signal handlers
+int evloop_wake(evloop_t* loop) {
+    uint64_t one = 1;
+    if (!loop || loop->wake_fd < 0) return -1;
+    
+    // A full counter already means a wake-up is pending
+    if (write(loop->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) return -1;
+    return 0;
+}
+
+// Sleep until a source is ready or timeout_ms passes (-1 waits forever).
+// Returns the EVLOOP_* sources that fired, 0 on timeout and -1 on error.
+// Timer and wake counts are consumed here; watched descriptors are left for
+// the caller to read, and input_fd receives the first ready one.
+int evloop_wait(evloop_t* loop, int timeout_ms, int* input_fd) {
+    struct pollfd fds[EVLOOP_MAX_WATCH + 2];
+    if (!loop || loop->timer_fd < 0) return -1;
+    
+    fds[0].fd = loop->timer_fd;
+    fds[1].fd = loop->wake_fd;
+    for (size_t i = 0; i < loop->watch_count; i++) {
+        fds[i + 2].fd = loop->watch_fds[i];
+    }
+    nfds_t count = (nfds_t)loop->watch_count + 2;
+    for (nfds_t i = 0; i < count; i++) {
+        fds[i].events = POLLIN;
+        fds[i].revents = 0;
+    }
+    
+    int ready;
+    do {
+        ready = poll(fds, count, timeout_ms);
+    } while (ready < 0 && errno == EINTR);
+    if (ready <= 0) return ready;
+    
+    int sources = 0;
+    uint64_t value;
+    if ((fds[0].revents & POLLIN) && read(loop->timer_fd, &value, sizeof(value)) == sizeof(value)) {
+        sources |= EVLOOP_TIMER;
+    }
+    if ((fds[1].revents & POLLIN) && read(loop->wake_fd, &value, sizeof(value)) == sizeof(value)) {
+        sources |= EVLOOP_WAKE;
+    }
+    for (nfds_t i = 2; i < count; i++) {
+        if (fds[i].revents & (POLLIN | POLLHUP | POLLERR | POLLNVAL)) {
+            if (input_fd) *input_fd = fds[i].fd;
+            sources |= EVLOOP_INPUT;
+            break;
+        }
+    }
+    return sources;
+}
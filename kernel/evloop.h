@@ -0,0 +1,33 @@
+#ifndef EVLOOP_H
+#define EVLOOP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Blocking waits for event loops: a timerfd for the next deadline, an
+// eventfd other threads use to wake the loop, and any descriptors to watch
+// for input, all behind one poll. Nothing wakes the loop otherwise.
+#define EVLOOP_MAX_WATCH 8
+
+// Sources reported by evloop_wait
+#define EVLOOP_TIMER 1 // The timer expired
+#define EVLOOP_WAKE  2 // evloop_wake was called
+#define EVLOOP_INPUT 4 // A watched descriptor is readable or closed
+
+typedef struct {
+    int timer_fd;
+    int wake_fd;
+    int watch_fds[EVLOOP_MAX_WATCH];
+    size_t watch_count;
+} evloop_t;
+
+// Function declarations
+int evloop_init(evloop_t* loop);
+void evloop_destroy(evloop_t* loop);
+int evloop_set_timer(evloop_t* loop, unsigned first_ms, unsigned interval_ms);
+int evloop_watch(evloop_t* loop, int fd);
+int evloop_unwatch(evloop_t* loop, int fd);
+int evloop_wake(evloop_t* loop);
+int evloop_wait(evloop_t* loop, int timeout_ms, int* input_fd);
+
+#endif // EVLOOP_H
@@ -0,0 +1,335 @@
+#define _GNU_SOURCE
+#include "ipc.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define IPC_MAGIC      0x4d444950u // "MDIP"
+#define IPC_CACHE_LINE 64
+#define IPC_MAX_SLOTS  (1u << 20)
+
+// Shared layout. The producer index, the consumer index and the sleep flag
+// each get a cache line so the two sides do not bounce one between them.
+struct ipc_header {
+    uint32_t magic;      // Stored last, once the channel is usable
+    uint32_t mode;
+    uint32_t slot_size;  // Largest message
+    uint32_t slot_count; // Power of two
+    uint32_t slot_stride;
+    int32_t doorbell_fd; // Descriptor number in the creator, inherited by its children
+    int32_t creator_pid;
+    char pad0[IPC_CACHE_LINE - 7 * sizeof(uint32_t)];
+    uint64_t tail;       // Next slot to claim for sending
+    char pad1[IPC_CACHE_LINE - sizeof(uint64_t)];
+    uint64_t head;       // Next slot to receive, consumer only
+    char pad2[IPC_CACHE_LINE - sizeof(uint64_t)];
+    uint32_t sleeping;   // The consumer is about to wait on the doorbell
+    char pad3[IPC_CACHE_LINE - sizeof(uint32_t)];
+};
+
+// A slot is free for the sender claiming position pos when seq == pos, and
+// holds a message for the receiver at pos when seq == pos + 1
+typedef struct {
+    uint64_t seq;
+    uint32_t length;
+    uint32_t reserved;
+    unsigned char data[];
+} ipc_slot_t;
+
+static ipc_slot_t* ipc_slot(ipc_header_t* header, uint64_t pos) {
+    size_t index = (size_t)(pos & (header->slot_count - 1));
+    return (ipc_slot_t*)((char*)(header + 1) + index * header->slot_stride);
+}
+
+static int ipc_shm_name(char* buffer, size_t size, const char* name) {
+    if (!name || !*name || strchr(name, '/') || strlen(name) >= IPC_NAME_MAX) return -1;
+    
+    snprintf(buffer, size, "/%s", name);
+    return 0;
+}
+
+static ipc_channel_t* ipc_channel_alloc(const char* name, ipc_header_t* header, size_t map_size) {
+    ipc_channel_t* channel = malloc(sizeof(ipc_channel_t));
+    if (!channel) return NULL;
+    
+    channel->header = header;
+    channel->map_size = map_size;
+    channel->doorbell_fd = -1;
+    channel->creator = 0;
+    strncpy(channel->name, name, sizeof(channel->name) - 1);
+    channel->name[sizeof(channel->name) - 1] = '\0';
+    return channel;
+}
+
+// A channel may only be replaced once its creator is gone, as after a crash.
+// One created under our own PID was left by an earlier process with it.
+static int ipc_channel_stale(const char* shm_name) {
+    int fd = shm_open(shm_name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) return errno == ENOENT;
+    
+    int32_t creator = 0;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(ipc_header_t)) {
+        ipc_header_t* header = mmap(NULL, sizeof(ipc_header_t), PROT_READ, MAP_SHARED, fd, 0);
+        if (header != MAP_FAILED) {
+            creator = header->creator_pid;
+            munmap(header, sizeof(ipc_header_t));
+        }
+    }
+    close(fd);
+    
+    if (creator <= 0 || creator == (int32_t)getpid()) return 1;
+    return kill((pid_t)creator, 0) != 0 && errno == ESRCH;
+}
+
+// Create a channel and its doorbell. A channel of the same name is only
+// replaced when its creator no longer runs.
+ipc_channel_t* ipc_channel_create(const char* name, int mode, size_t slot_size, uint32_t slot_count) {
+    char shm_name[IPC_NAME_MAX + 1];
+    if (ipc_shm_name(shm_name, sizeof(shm_name), name) != 0) return NULL;
+    if ((mode != IPC_SPSC && mode != IPC_MPSC) || slot_size == 0 || slot_size > UINT32_MAX / 2) return NULL;
+    if (slot_count == 0 || slot_count > IPC_MAX_SLOTS || (slot_count & (slot_count - 1))) return NULL;
+    
+    size_t stride = (sizeof(ipc_slot_t) + slot_size + IPC_CACHE_LINE - 1) & ~(size_t)(IPC_CACHE_LINE - 1);
+    size_t map_size = sizeof(ipc_header_t) + stride * slot_count;
+    
+    int fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0 && errno == EEXIST && ipc_channel_stale(shm_name)) {
+        shm_unlink(shm_name);
+        fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    }
+    if (fd < 0) {
+        fprintf(stderr, "IPC: Cannot create channel '%s': %s\n", name, strerror(errno));
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t)map_size) != 0) {
+        close(fd);
+        shm_unlink(shm_name);
+        return NULL;
+    }
+    ipc_header_t* header = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (header == MAP_FAILED) {
+        shm_unlink(shm_name);
+        return NULL;
+    }
+    
+    // Not close-on-exec: standalone apps find it at the same number
+    int doorbell = eventfd(0, EFD_NONBLOCK);
+    ipc_channel_t* channel = doorbell >= 0 ? ipc_channel_alloc(name, header, map_size) : NULL;
+    if (!channel) {
+        if (doorbell >= 0) {
+            close(doorbell);
+        }
+        munmap(header, map_size);
+        shm_unlink(shm_name);
+        return NULL;
+    }
+    channel->doorbell_fd = doorbell;
+    channel->creator = 1;
+    
+    header->mode = (uint32_t)mode;
+    header->slot_size = (uint32_t)slot_size;
+    header->slot_count = slot_count;
+    header->slot_stride = (uint32_t)stride;
+    header->doorbell_fd = doorbell;
+    header->creator_pid = (int32_t)getpid();
+    for (uint32_t i = 0; i < slot_count; i++) {
+        ipc_slot(header, i)->seq = i;
+    }
+    __atomic_store_n(&header->magic, IPC_MAGIC, __ATOMIC_RELEASE);
+    
+    printf("IPC: Created channel '%s' (%s, %u slots of %zu bytes)\n",
+           name, mode == IPC_MPSC ? "MPSC" : "SPSC", slot_count, slot_size);
+    return channel;
+}
+
+// The creator's doorbell, if this process has it: its own, or inherited
+// at the same descriptor number by a child the creator launched
+static int ipc_doorbell_reachable(const ipc_header_t* header) {
+    if (header->creator_pid == (int32_t)getpid()) return 1;
+    if (header->creator_pid != (int32_t)getppid()) return 0;
+    
+    char path[64];
+    char target[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", header->doorbell_fd);
+    ssize_t length = readlink(path, target, sizeof(target) - 1);
+    if (length < 0) return 0;
+    target[length] = '\0';
+    return strcmp(target, "anon_inode:[eventfd]") == 0;
+}
+
+// Open an existing channel; NULL if it does not exist or its doorbell is
+// out of reach of this process
+ipc_channel_t* ipc_channel_open(const char* name) {
+    char shm_name[IPC_NAME_MAX + 1];
+    if (ipc_shm_name(shm_name, sizeof(shm_name), name) != 0) return NULL;
+    
+    int fd = shm_open(shm_name, O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ipc_header_t)) {
+        close(fd);
+        return NULL;
+    }
+    size_t map_size = (size_t)st.st_size;
+    ipc_header_t* header = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (header == MAP_FAILED) return NULL;
+    
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != IPC_MAGIC ||
+        header->slot_count == 0 || (header->slot_count & (header->slot_count - 1)) ||
+        sizeof(ipc_header_t) + (size_t)header->slot_stride * header->slot_count > map_size ||
+        !ipc_doorbell_reachable(header)) {
+        munmap(header, map_size);
+        return NULL;
+    }
+    ipc_channel_t* channel = ipc_channel_alloc(name, header, map_size);
+    if (channel) {
+        channel->doorbell_fd = fcntl(header->doorbell_fd, F_DUPFD_CLOEXEC, 0);
+    }
+    if (!channel || channel->doorbell_fd < 0) {
+        free(channel);
+        munmap(header, map_size);
+        return NULL;
+    }
+    return channel;
+}
+
+void ipc_channel_close(ipc_channel_t* channel) {
+    if (!channel) return;
+    
+    if (channel->creator) {
+        char shm_name[IPC_NAME_MAX + 1];
+        if (ipc_shm_name(shm_name, sizeof(shm_name), channel->name) == 0) {
+            shm_unlink(shm_name);
+        }
+    }
+    close(channel->doorbell_fd);
+    munmap(channel->header, channel->map_size);
+    free(channel);
+}
+
+int ipc_channel_send(ipc_channel_t* channel, const void* data, size_t size) {
+    ipc_header_t* header = channel->header;
+    if (size > header->slot_size) return -1;
+    
+    // Claim a slot
+    uint64_t pos = __atomic_load_n(&header->tail, __ATOMIC_RELAXED);
+    ipc_slot_t* slot;
+    for (;;) {
+        slot = ipc_slot(header, pos);
+        uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(seq - pos);
+        if (diff == 0) {
+            if (header->mode == IPC_SPSC) {
+                __atomic_store_n(&header->tail, pos + 1, __ATOMIC_RELAXED);
+                break;
+            }
+            if (__atomic_compare_exchange_n(&header->tail, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return -1; // Full: the consumer has not freed this slot yet
+        } else {
+            pos = __atomic_load_n(&header->tail, __ATOMIC_RELAXED);
+        }
+    }
+    
+    memcpy(slot->data, data, size);
+    slot->length = (uint32_t)size;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+    
+    // Either we see the consumer's sleeping flag or it sees this message;
+    // pairs with the fence in ipc_channel_arm
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&header->sleeping, __ATOMIC_RELAXED) &&
+        __atomic_exchange_n(&header->sleeping, 0, __ATOMIC_ACQ_REL)) {
+        uint64_t one = 1;
+        if (write(channel->doorbell_fd, &one, sizeof(one)) < 0) {
+            // Only fails when the counter would overflow, and then it is readable anyway
+        }
+    }
+    return 0;
+}
+
+// Copies up to size bytes of the oldest message; *received gets its full
+// length, which is larger than size if it was cut short
+int ipc_channel_receive(ipc_channel_t* channel, void* buffer, size_t size, size_t* received) {
+    ipc_header_t* header = channel->header;
+    uint64_t pos = __atomic_load_n(&header->head, __ATOMIC_RELAXED);
+    ipc_slot_t* slot = ipc_slot(header, pos);
+    
+    uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if ((int64_t)(seq - (pos + 1)) < 0) return -1; // Empty
+    
+    size_t length = slot->length;
+    memcpy(buffer, slot->data, length < size ? length : size);
+    if (received) {
+        *received = length;
+    }
+    __atomic_store_n(&header->head, pos + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, pos + header->slot_count, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static int ipc_channel_pending(ipc_header_t* header) {
+    uint64_t pos = __atomic_load_n(&header->head, __ATOMIC_RELAXED);
+    uint64_t seq = __atomic_load_n(&ipc_slot(header, pos)->seq, __ATOMIC_ACQUIRE);
+    return (int64_t)(seq - (pos + 1)) >= 0;
+}
+
+int ipc_channel_fd(const ipc_channel_t* channel) {
+    return channel ? channel->doorbell_fd : -1;
+}
+
+size_t ipc_channel_slot_size(const ipc_channel_t* channel) {
+    return channel ? channel->header->slot_size : 0;
+}
+
+// Returns 1 if a message is already waiting, in which case the caller
+// should receive instead of sleeping
+int ipc_channel_arm(ipc_channel_t* channel) {
+    ipc_header_t* header = channel->header;
+    
+    // Drain rings from earlier sleeps so the next poll only sees a new one.
+    // A ring still in flight from before costs one spurious wake-up at most.
+    uint64_t count;
+    if (read(channel->doorbell_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) return -1;
+    
+    __atomic_store_n(&header->sleeping, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (ipc_channel_pending(header)) {
+        __atomic_store_n(&header->sleeping, 0, __ATOMIC_RELAXED);
+        return 1;
+    }
+    return 0;
+}
+
+// Block until a message is waiting or timeout_ms passes (-1 waits
+// forever); returns 1 if one is waiting
+int ipc_channel_wait(ipc_channel_t* channel, int timeout_ms) {
+    if (!channel) return -1;
+    
+    int armed = ipc_channel_arm(channel);
+    if (armed != 0) return armed;
+    
+    struct pollfd pfd;
+    pfd.fd = channel->doorbell_fd;
+    pfd.events = POLLIN;
+    int ready;
+    do {
+        ready = poll(&pfd, 1, timeout_ms);
+    } while (ready < 0 && errno == EINTR);
+    __atomic_store_n(&channel->header->sleeping, 0, __ATOMIC_RELAXED);
+    return ipc_channel_pending(channel->header);
+}
@@ -0,0 +1,55 @@
+#ifndef IPC_H
+#define IPC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Named message channels in POSIX shared memory, shared by simulated
+// processes and host processes alike. A channel is a bounded ring of
+// fixed-size slots, each with a sequence number, so sending and receiving
+// are a few atomic operations with no system call. One consumer drains it;
+// IPC_MPSC lets any number of producers send at once. The eventfd doorbell
+// is only rung when the consumer has announced it is going to sleep.
+//
+// The doorbell cannot be looked up by name: host processes reach it by
+// inheriting it from the creator, so channels meant for standalone apps are
+// created before app_execute_standalone forks them.
+#define IPC_NAME_MAX     48
+
+// Standalone apps to the desktop. Each instance names its own by its PID,
+// which the apps it forks rebuild from getppid().
+#define IPC_APPS_CHANNEL "mindose-apps-%d"
+
+// Channel modes
+#define IPC_SPSC 0 // One producer: a send is a load and two stores
+#define IPC_MPSC 1 // Producers claim slots with a compare-and-swap
+
+typedef struct ipc_header ipc_header_t;
+
+// A process's handle on a channel
+typedef struct {
+    ipc_header_t* header;
+    size_t map_size;
+    int doorbell_fd; // Our own descriptor for the doorbell
+    int creator;     // Unlinks the name on close
+    char name[IPC_NAME_MAX];
+} ipc_channel_t;
+
+// Function declarations
+ipc_channel_t* ipc_channel_create(const char* name, int mode, size_t slot_size, uint32_t slot_count);
+ipc_channel_t* ipc_channel_open(const char* name);
+void ipc_channel_close(ipc_channel_t* channel);
+
+// Fast path, never blocks: 0 on success, -1 when full (send) or empty (receive)
+int ipc_channel_send(ipc_channel_t* channel, const void* data, size_t size);
+int ipc_channel_receive(ipc_channel_t* channel, void* buffer, size_t size, size_t* received);
+
+// Sleeping, consumer side. ipc_channel_arm announces a sleep and returns 1
+// if a message arrived meanwhile; otherwise the doorbell descriptor becomes
+// readable on the next send. ipc_channel_wait does both with a poll.
+int ipc_channel_fd(const ipc_channel_t* channel);
+int ipc_channel_arm(ipc_channel_t* channel);
+int ipc_channel_wait(ipc_channel_t* channel, int timeout_ms);
+size_t ipc_channel_slot_size(const ipc_channel_t* channel);
+
+#endif // IPC_H
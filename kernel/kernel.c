@@ -1,11 +1,85 @@
 #define _GNU_SOURCE
 #include "kernel.h"
+#include "slab.h"
+#include "zram.h"
+#include "memtrace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <ucontext.h>
 #include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 
 static kernel_state_t kernel_state = {0};
+static kmem_cache_t* process_cache = NULL;
+static uint32_t merge_switches = 0; // Process switches so far, to pace the merge scanner
+static kmem_cache_t* envelope_cache = NULL; // Page messages and grants
+static kmem_cache_t* grant_cache = NULL;
+static pidmap_t page_grants;
+static uint32_t next_grant = 1;
+
+// Host execution context of a started process
+struct process_context {
+    ucontext_t uc;
+    void* stack;
+    process_entry_t entry;
+    void* arg;
+    volatile sig_atomic_t preempt_count; // Timer preemption is off while non-zero
+    volatile sig_atomic_t need_resched;  // A tick arrived while preemption was off
+    int kernel_depth; // kernel_enter nesting; the kernel lock travels with the context
+    int preempted; // Why the process last returned to its CPU's loop
+    int exited;
+};
+
+// The host thread behind a CPU
+typedef struct {
+    pthread_t thread;
+    pid_t tid;
+    timer_t timer;
+    int timer_armed;
+    ucontext_t context; // The CPU's scheduling loop
+} cpu_host_t;
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+static cpu_host_t cpu_hosts[SCHED_MAX_CPUS];
+static pthread_mutex_t cpu_hosts_lock = PTHREAD_MUTEX_INITIALIZER; // Timers and thread start/stop
+static unsigned timer_interval_us = 0;
+static int workers_running = 0;
+
+// The allocator, the page tables and page messages run under the kernel
+// lock. The process table, the timer wheel, wait queues and run queues each
+// have their own, so blocking, waking and lookups never take it.
+static pthread_mutex_t kernel_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_rwlock_t process_table_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+// Per host thread: its CPU, the process context it executes right now, and
+// kernel_enter nesting while it runs its own loop
+static __thread scheduler_cpu_t* this_cpu = NULL;
+static __thread process_context_t* volatile running_context = NULL;
+static __thread int kernel_depth = 0;
+static sigset_t timer_signals;
+
+// Kernel timers, under the timer lock. timer_next caches the next tick with
+// work so CPUs can check for expiries without taking the lock.
+static pthread_mutex_t timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static timer_wheel_t timer_wheel;
+static uint64_t timer_next = TIMER_WHEEL_NONE;
+
+static uint64_t timer_now_tick(void) {
+    return scheduler_now_ns() / KERNEL_TIMER_TICK_NS;
+}
+
+// Caller holds the timer lock
+static void timer_update_next(void) {
+    __atomic_store_n(&timer_next, timer_wheel_next(&timer_wheel), __ATOMIC_RELEASE);
+}
 
 // Parse memory size string (e.g., "512M", "1G") to bytes
 static size_t parse_memory_size(const char* size_str) {
@@ -14,197 +88,2357 @@ static size_t parse_memory_size(const char* size_str) {
     size_t size = 0;
     char unit = 0;
     
-    if (sscanf(size_str, "%zu%c", &size, &unit) >= 1) {
-        switch (unit) {
-            case 'K': case 'k': return size * 1024;
-            case 'M': case 'm': return size * 1024 * 1024;
-            case 'G': case 'g': return size * 1024 * 1024 * 1024;
-            default: return size;
+    if (sscanf(size_str, "%zu%c", &size, &unit) >= 1) {
+        switch (unit) {
+            case 'K': case 'k': return size * 1024;
+            case 'M': case 'm': return size * 1024 * 1024;
+            case 'G': case 'g': return size * 1024 * 1024 * 1024;
+            default: return size;
+        }
+    }
+    
+    return 256 * 1024 * 1024; // Default fallback
+}
+
+int kernel_init(mindose_config_t* config) {
+    printf("Kernel: Initializing core systems...\n");
+    
+    // Initialize memory management
+    size_t mem_size = parse_memory_size(config->mem_size);
+    if (memory_init(mem_size) != 0) {
+        fprintf(stderr, "Kernel: Failed to initialize memory management\n");
+        return -1;
+    }
+    kernel_state.memory_mgr.huge_pages = config->huge_pages;
+    
+    if (config->mem_trace) {
+        if (memtrace_init() != 0) {
+            fprintf(stderr, "Kernel: Failed to initialize allocation tracing\n");
+            return -1;
+        }
+        kernel_state.memory_mgr.tracing = 1;
+    }
+    
+    // Compressed page pool, a quarter of memory unless --zram says otherwise
+    size_t zram_size = config->zram_size ? parse_memory_size(config->zram_size) : mem_size / 4;
+    if (zram_init(zram_size) != 0) {
+        fprintf(stderr, "Kernel: Failed to initialize zram\n");
+        return -1;
+    }
+    
+    // Initialize scheduler
+    if (scheduler_init() != 0) {
+        fprintf(stderr, "Kernel: Failed to initialize scheduler\n");
+        return -1;
+    }
+    
+    // Initialize device management
+    if (device_init(config) != 0) {
+        fprintf(stderr, "Kernel: Failed to initialize device management\n");
+        return -1;
+    }
+    
+    // Initialize virtual memory, swapping to the disk image if there is one
+    if (paging_init(kernel_state.device_mgr.diskimage_path) != 0) {
+        fprintf(stderr, "Kernel: Failed to initialize paging\n");
+        return -1;
+    }
+    
+    // CPU 0 is this thread, the others get host threads of their own
+    if (config->cpus > 1 && scheduler_start_cpus((uint32_t)config->cpus) != 0) {
+        fprintf(stderr, "Kernel: Failed to start %d CPUs\n", config->cpus);
+        return -1;
+    }
+    
+    kernel_state.initialized = 1;
+    printf("Kernel: Initialization complete\n");
+    return 0;
+}
+
+void kernel_cleanup(void) {
+    if (!kernel_state.initialized) return;
+    
+    printf("Kernel: Shutting down...\n");
+    
+    memory_stats_t stats;
+    memory_get_stats(&stats);
+    printf("Memory: %zu of %zu bytes free in %zu runs (fragmentation %.1f%%)\n",
+           stats.free_bytes, stats.total_bytes, stats.free_runs, stats.fragmentation * 100.0);
+    
+    paging_stats_t paging;
+    paging_get_stats(&paging);
+    printf("Paging: %zu zero fills, %zu swap ins, %zu swap outs, TLB %zu hits / %zu misses\n",
+           paging.zero_fills, paging.swap_ins, paging.swap_outs, paging.tlb_hits, paging.tlb_misses);
+    
+    printf("Merge: %zu pages saved, %zu merged, %zu frames scanned in %zu passes, %.3f ms CPU\n",
+           paging.merge_saved, paging.merge_merged, paging.merge_scanned, paging.merge_passes,
+           paging.merge_scan_ns / 1e6);
+    
+    printf("Transfer: %zu pages moved, %zu granted, %zu unmapped, %zu copy-on-write copies\n",
+           paging.pages_moved, paging.pages_granted, paging.pages_unmapped, paging.cow_copies);
+    
+    if (kernel_state.memory_mgr.tracing) {
+        memtrace_snapshot_t trace;
+        memtrace_snapshot(&trace);
+        printf("Memtrace: %zu bytes live in %zu blocks, %zu bytes leaked in %zu blocks, %llu events\n",
+               trace.live_bytes, trace.live_blocks, trace.leaked_bytes, trace.leaked_blocks,
+               (unsigned long long)trace.events);
+        for (size_t i = 0; i < trace.site_count; i++) {
+            printf("Memtrace:   %p holds %zu bytes in %zu blocks\n",
+                   trace.sites[i].site, trace.sites[i].live_bytes, trace.sites[i].live_blocks);
+        }
+    }
+    
+    zram_stats_t zram;
+    zram_get_stats(&zram);
+    scheduler_stop_cpus();
+    scheduler_set_timer(0);
+    
+    scheduler_stats_t sched;
+    scheduler_get_stats(&sched);
+    printf("Scheduler: %u CPUs, %llu ticks, %llu context switches, %llu preemptions, %llu steals\n",
+           sched.cpus, (unsigned long long)sched.ticks, (unsigned long long)sched.switches,
+           (unsigned long long)sched.preemptions, (unsigned long long)sched.steals);
+    
+    syscall_stat_t calls[SYSCALL_MAX];
+    size_t call_count = syscall_get_stats(calls, SYSCALL_MAX);
+    for (size_t i = 0; i < call_count; i++) {
+        printf("Syscalls: %-14s %llu calls, avg %llu ns / max %llu ns\n", calls[i].name,
+               (unsigned long long)calls[i].calls,
+               (unsigned long long)(calls[i].total_ns / calls[i].calls),
+               (unsigned long long)calls[i].max_ns);
+    }
+    
+    printf("Zram: %zu pages in %zu of %zu bytes (ratio %.2f), %zu same-filled, %zu rejected, "
+           "decompress avg %llu ns / max %llu ns\n",
+           zram.stored_pages, zram.pool_bytes, zram.pool_limit,
+           zram.pool_bytes ? (double)zram.original_bytes / zram.pool_bytes : 0.0,
+           zram.same_filled_pages, zram.rejected_pages,
+           (unsigned long long)(zram.decompressions ? zram.decompress_ns_total / zram.decompressions : 0),
+           (unsigned long long)zram.decompress_ns_max);
+    
+    buffer_cache_t* cache = device_get_cache();
+    if (cache) {
+        bcache_stats_t buffers;
+        bcache_get_stats(cache, &buffers);
+        uint64_t lookups = buffers.hits + buffers.misses;
+        printf("Bcache: %zu of %zu buffers (%zu hot), %llu hits / %llu misses (%.1f%%), %llu ghost hits, "
+               "%llu promotions, %llu evictions, %llu write-backs\n",
+               buffers.resident, buffers.capacity, buffers.hot,
+               (unsigned long long)buffers.hits, (unsigned long long)buffers.misses,
+               lookups ? buffers.hits * 100.0 / lookups : 0.0, (unsigned long long)buffers.ghost_hits,
+               (unsigned long long)buffers.promotions, (unsigned long long)buffers.evictions,
+               (unsigned long long)buffers.writebacks);
+    }
+    
+    block_device_t* disk = device_get_disk();
+    if (disk) {
+        block_stats_t block;
+        block_get_stats(disk, &block);
+        printf("Block: %llu reads, %llu writes, %llu blocks synced in %llu msync calls, %llu dirty\n",
+               (unsigned long long)block.reads, (unsigned long long)block.writes,
+               (unsigned long long)block.synced_blocks, (unsigned long long)block.syncs,
+               (unsigned long long)block.dirty_blocks);
+    }
+    
+    device_cleanup();
+    paging_cleanup();
+    zram_cleanup();
+    memory_cleanup();
+    memtrace_cleanup();
+    pidmap_destroy(&kernel_state.scheduler.processes);
+    pidmap_destroy(&page_grants);
+    for (uint32_t i = 0; i < SCHED_MAX_CPUS; i++) {
+        pthread_mutex_destroy(&kernel_state.scheduler.cpus[i].lock);
+        pthread_cond_destroy(&kernel_state.scheduler.cpus[i].wake);
+    }
+    kernel_state.memory_mgr.tracing = 0;
+    process_cache = NULL;
+    envelope_cache = NULL;
+    grant_cache = NULL;
+    kernel_state.initialized = 0;
+}
+
+// Memory Management Implementation
+static unsigned memory_floor_order(size_t pages) {
+    return (unsigned)(sizeof(unsigned long long) * 8 - 1) - (unsigned)__builtin_clzll(pages);
+}
+
+// Smallest order whose block holds the given number of pages
+static unsigned memory_ceil_order(size_t pages) {
+    unsigned order = memory_floor_order(pages);
+    return ((size_t)1 << order) < pages ? order + 1 : order;
+}
+
+// Write the header and footer tags of a run
+static void memory_tag_run(uint32_t index, uint32_t run, uint8_t flags) {
+    memory_manager_t* mm = &kernel_state.memory_mgr;
+    memory_page_t* head = &mm->pages[index];
+    memory_page_t* tail = &mm->pages[index + run - 1];
+    
+    tail->run = run;
+    tail->flags = flags | MEMORY_PAGE_TAIL;
+    head->run = run;
+    head->flags = (run == 1 ? tail->flags : flags) | MEMORY_PAGE_HEAD;
+}
+
+static void memory_clear_tags(uint32_t index, uint32_t run) {
+    memory_manager_t* mm = &kernel_state.memory_mgr;
+    mm->pages[index].flags = 0;
+    mm->pages[index + run - 1].flags = 0;
+}
+
+static void memory_free_list_push(uint32_t index, uint32_t run, uint8_t dirty) {
+    memory_manager_t* mm = &kernel_state.memory_mgr;
+    memory_page_t* page = &mm->pages[index];
+    unsigned order = memory_floor_order(run);
+    
+    memory_tag_run(index, run, MEMORY_PAGE_FREE | dirty);
+    page->order = (uint8_t)order;
+    page->prev = MEMORY_PAGE_NONE;
+    page->next = mm->free_lists[order];
+    
+    if (page->next != MEMORY_PAGE_NONE) {
+        mm->pages[page->next].prev = index;
+    }
+    mm->free_lists[order] = index;
+    mm->free_bitmap |= 1u << order;
+    mm->free_pages += run;
+    mm->free_runs++;
+    if (dirty) {
+        mm->dirty_pages += run;
+    }
+}
+
+static void memory_free_list_remove(uint32_t index) {
+    memory_manager_t* mm = &kernel_state.memory_mgr;
+    memory_page_t* page = &mm->pages[index];
+    unsigned order = page->order;
+    
+    if (page->prev != MEMORY_PAGE_NONE) {
+        mm->pages[page->prev].next = page->next;
+    } else {
+        mm->free_lists[order] = page->next;
+    }
+    if (page->next != MEMORY_PAGE_NONE) {
+        mm->pages[page->next].prev = page->prev;
+    }
+    
+    if (mm->free_lists[order] == MEMORY_PAGE_NONE) {
+        mm->free_bitmap &= ~(1u << order);
+    }
+    mm->free_pages -= page->run;
+    mm->free_runs--;
+    if (page->flags & MEMORY_PAGE_DIRTY) {
+        mm->dirty_pages -= page->run;
+    }
+    memory_clear_tags(index, page->run);
+}
+
+// Hand the backing of a free run back to the host; it reads as zero afterwards
+static void memory_release_pages(uint32_t index, uint32_t run) {
+    memory_manager_t* mm = &kernel_state.memory_mgr;
+    madvise(mm->arena + ((size_t)index << MEMORY_PAGE_SHIFT), (size_t)run << MEMORY_PAGE_SHIFT, MADV_DONTNEED);
+}
+
+// Ask for transparent huge pages on the 2 MiB aligned part of a large run
+static void memory_advise_huge(uint32_t index, uint32_t run) {
+#ifdef MADV_HUGEPAGE
+    memory_manager_t* mm = &kernel_state.memory_mgr;
+    uintptr_t start = (uintptr_t)(mm->arena + ((size_t)index << MEMORY_PAGE_SHIFT));
+    uintptr_t end = start + ((size_t)run << MEMORY_PAGE_SHIFT);
+    
+    start = (start + MEMORY_HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(MEMORY_HUGE_PAGE_SIZE - 1);
+    end &= ~(uintptr_t)(MEMORY_HUGE_PAGE_SIZE - 1);
+    if (end > start) {
+        madvise((void*)start, end - start, MADV_HUGEPAGE);
+    }
+#else
+    (void)index; (void)run;
+#endif
+}
+
+// Find a free run of at least the given number of pages
+static uint32_t memory_find_run(size_t pages) {
+    memory_manager_t* mm = &kernel_state.memory_mgr;
+    unsigned order = memory_ceil_order(pages);
+    
+    // Any run on a list at or above the rounded-up order fits
+    if (order < MEMORY_MAX_ORDER) {
+        uint32_t candidates = mm->free_bitmap & ~((1u << order) - 1);
+        if (candidates) {
+            return mm->free_lists[__builtin_ctz(candidates)];
+        }
+    }
+    
+    // Otherwise only the list below may still hold a large enough run
+    unsigned floor = memory_floor_order(pages);
+    if (floor != order) {
+        for (uint32_t index = mm->free_lists[floor]; index != MEMORY_PAGE_NONE; index = mm->pages[index].next) {
+            if (mm->pages[index].run >= pages) {
+                return index;
+            }
+        }
+    }
+    
+    return MEMORY_PAGE_NONE;
+}
+
+int memory_init(size_t total_size) {
+    memory_manager_t* mm = &kernel_state.memory_mgr;
+    size_t page_count = total_size >> MEMORY_PAGE_SHIFT;
+    
+    if (page_count == 0 || page_count > UINT32_MAX - 1) {
+        return -1;
+    }
+    
+    mm->total_memory = page_count << MEMORY_PAGE_SHIFT;
+    mm->page_count = (uint32_t)page_count;
+    
+    mm->pages = calloc(page_count, sizeof(memory_page_t));
+    if (!mm->pages) {
+        return -1;
+    }
+    
+    // Reserve address space only; host pages are committed on first touch.
+    // The extra huge page of slack lets the arena start 2 MiB aligned.
+    size_t reserve = mm->total_memory + MEMORY_HUGE_PAGE_SIZE;
+    uint8_t* region = mmap(NULL, reserve, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (region == MAP_FAILED) {
+        free(mm->pages);
+        mm->pages = NULL;
+        return -1;
+    }
+    
+    uint8_t* aligned = (uint8_t*)(((uintptr_t)region + MEMORY_HUGE_PAGE_SIZE - 1) &
+                                  ~(uintptr_t)(MEMORY_HUGE_PAGE_SIZE - 1));
+    if (aligned > region) {
+        munmap(region, (size_t)(aligned - region));
+    }
+    if (aligned + mm->total_memory < region + reserve) {
+        munmap(aligned + mm->total_memory, (size_t)(region + reserve - (aligned + mm->total_memory)));
+    }
+    mm->arena = aligned;
+    
+    for (unsigned order = 0; order < MEMORY_MAX_ORDER; order++) {
+        mm->free_lists[order] = MEMORY_PAGE_NONE;
+    }
+    mm->free_bitmap = 0;
+    mm->free_pages = 0;
+    mm->free_runs = 0;
+    mm->dirty_pages = 0;
+    
+    // The whole arena starts out as a single untouched free run
+    memory_free_list_push(0, mm->page_count, 0);
+    
+    if (kmem_init() != 0) {
+        memory_cleanup();
+        return -1;
+    }
+    
+    printf("Memory: Initialized %zu bytes (%u pages)\n", mm->total_memory, mm->page_count);
+    return 0;
+}
+
+// Align is a power of two; anything up to KMEM_OBJECT_ALIGN is the default
+static void* memory_alloc_untraced(size_t size, size_t align) {
+    memory_manager_t* mm = &kernel_state.memory_mgr;
+    
+    if (size == 0 || !mm->arena || size > mm->total_memory || align > mm->total_memory) {
+        return NULL;
+    }
+    
+    // Small requests are served from the slab size classes; rounding up to
+    // the alignment picks a class whose objects are aligned that far
+    if (size <= KMEM_MAX_SIZE && align <= KMEM_SLAB_ALIGN) {
+        void* object = kmem_alloc(size < align ? align : size);
+        if (object) return object;
+    }
+    
+    // Runs are page aligned; stricter alignment asks for enough slack to
+    // find an aligned start inside the run
+    size_t pages = (size + MEMORY_PAGE_SIZE - 1) >> MEMORY_PAGE_SHIFT;
+    size_t needed = pages;
+    if (align > MEMORY_PAGE_SIZE) {
+        needed += (align >> MEMORY_PAGE_SHIFT) - 1;
+    }
+    if (needed > mm->page_count) return NULL;
+    
+    uint32_t index = memory_find_run(needed);
+    if (index == MEMORY_PAGE_NONE && kmem_shrink() > 0) {
+        // Cached empty slabs may have been splitting a large enough run
+        index = memory_find_run(needed);
+    }
+    while (index == MEMORY_PAGE_NONE && paging_reclaim(1) > 0) {
+        // Push process pages out to swap until a large enough run forms
+        index = memory_find_run(needed);
+    }
+    if (index == MEMORY_PAGE_NONE) {
+        return NULL; // No suitable run found
+    }
+    
+    uint32_t run = mm->pages[index].run;
+    uint8_t dirty = mm->pages[index].flags & MEMORY_PAGE_DIRTY;
+    memory_free_list_remove(index);
+    
+    // Give back the pages in front of the first aligned one
+    if (align > MEMORY_PAGE_SIZE) {
+        uintptr_t start = (uintptr_t)(mm->arena + ((size_t)index << MEMORY_PAGE_SHIFT));
+        uint32_t lead = (uint32_t)((((start + align - 1) & ~(uintptr_t)(align - 1)) - start) >> MEMORY_PAGE_SHIFT);
+        if (lead > 0) {
+            memory_free_list_push(index, lead, dirty);
+            index += lead;
+            run -= lead;
+        }
+    }
+    
+    // Split off the unused tail and return it to the free lists
+    if (run > pages) {
+        memory_free_list_push(index + (uint32_t)pages, run - (uint32_t)pages, dirty);
+    }
+    memory_tag_run(index, (uint32_t)pages, 0);
+    
+    // Asking for huge page alignment is asking for huge pages
+    if ((mm->huge_pages || align >= MEMORY_HUGE_PAGE_SIZE) &&
+        ((size_t)pages << MEMORY_PAGE_SHIFT) >= MEMORY_HUGE_PAGE_SIZE) {
+        memory_advise_huge(index, (uint32_t)pages);
+    }
+    
+    return mm->arena + ((size_t)index << MEMORY_PAGE_SHIFT);
+}
+
+static void memory_free_untraced(void* ptr) {
+    memory_manager_t* mm = &kernel_state.memory_mgr;
+    uint8_t* addr = ptr;
+    
+    if (!addr || !mm->arena || addr < mm->arena || addr >= mm->arena + mm->total_memory) {
+        return;
+    }
+    
+    size_t offset = (size_t)(addr - mm->arena);
+    uint32_t index = (uint32_t)(offset >> MEMORY_PAGE_SHIFT);
+    
+    // Runs are page aligned, so anything else can only be a slab object
+    uint8_t flags = mm->pages[index].flags;
+    if (offset & (MEMORY_PAGE_SIZE - 1)) {
+        if ((flags & (MEMORY_PAGE_HEAD | MEMORY_PAGE_FREE | MEMORY_PAGE_SLAB)) == (MEMORY_PAGE_HEAD | MEMORY_PAGE_SLAB)) {
+            kmem_free(ptr);
+        }
+        return;
+    }
+    
+    // Slab pages go back through kmem_slab_release, never directly
+    if ((flags & (MEMORY_PAGE_HEAD | MEMORY_PAGE_FREE | MEMORY_PAGE_SLAB)) != MEMORY_PAGE_HEAD) {
+        return; // Not the start of an allocated run
+    }
+    
+    uint32_t run = mm->pages[index].run;
+    uint32_t freed = index;
+    uint32_t freed_run = run;
+    memory_clear_tags(index, run);
+    
+    // Absorb the left neighbour through its footer tag
+    uint32_t left = MEMORY_PAGE_NONE;
+    uint32_t left_run = 0;
+    if (index > 0 && (mm->pages[index - 1].flags & MEMORY_PAGE_FREE)) {
+        left = index - mm->pages[index - 1].run;
+        left_run = mm->pages[left].run;
+        if (!(mm->pages[left].flags & MEMORY_PAGE_DIRTY)) {
+            left = MEMORY_PAGE_NONE; // Already returned to the host
+        }
+        index -= left_run;
+        run += left_run;
+        memory_free_list_remove(index);
+    }
+    
+    // Absorb the right neighbour through its header tag
+    uint32_t right = freed + freed_run;
+    uint32_t right_run = 0;
+    if (right < mm->page_count && (mm->pages[right].flags & MEMORY_PAGE_FREE)) {
+        right_run = mm->pages[right].run;
+        if (!(mm->pages[right].flags & MEMORY_PAGE_DIRTY)) {
+            right = MEMORY_PAGE_NONE;
+        }
+        run += right_run;
+        memory_free_list_remove(freed + freed_run);
+    } else {
+        right = MEMORY_PAGE_NONE;
+    }
+    
+    // Give large runs back to the host, touching only the parts still committed
+    uint8_t dirty = MEMORY_PAGE_DIRTY;
+    if (run >= MEMORY_RELEASE_PAGES) {
+        memory_release_pages(freed, freed_run);
+        if (left != MEMORY_PAGE_NONE) {
+            memory_release_pages(left, left_run);
+        }
+        if (right != MEMORY_PAGE_NONE) {
+            memory_release_pages(right, right_run);
+        }
+        dirty = 0;
+    }
+    
+    memory_free_list_push(index, run, dirty);
+}
+
+static void* memory_alloc_traced(size_t size, size_t align, void* site) {
+    memory_manager_t* mm = &kernel_state.memory_mgr;
+    
+    // Slab pages and reclaim work done on behalf of this call are not traced
+    mm->trace_depth++;
+    void* ptr = memory_alloc_untraced(size, align);
+    mm->trace_depth--;
+    
+    if (ptr && mm->trace_depth == 0) {
+        process_t* current = process_get_current();
+        memtrace_alloc(ptr, size, site, current ? current->pid : 0);
+    }
+    return ptr;
+}
+
+// With tracing off these cost one predictable branch
+void* memory_alloc(size_t size) {
+    if (__builtin_expect(!kernel_state.memory_mgr.tracing, 1)) {
+        return memory_alloc_untraced(size, 0);
+    }
+    return memory_alloc_traced(size, 0, __builtin_return_address(0));
+}
+
+// Page or 2 MiB alignment comes from the run allocator, smaller powers of
+// two from the slab classes
+void* memory_alloc_aligned(size_t size, size_t align) {
+    if (align == 0 || (align & (align - 1)) != 0) {
+        return NULL;
+    }
+    if (__builtin_expect(!kernel_state.memory_mgr.tracing, 1)) {
+        return memory_alloc_untraced(size, align);
+    }
+    return memory_alloc_traced(size, align, __builtin_return_address(0));
+}
+
+void memory_free(void* ptr) {
+    if (__builtin_expect(kernel_state.memory_mgr.tracing, 0) && ptr) {
+        memtrace_free(ptr);
+    }
+    memory_free_untraced(ptr);
+}
+
+void memory_get_stats(memory_stats_t* stats) {
+    memory_manager_t* mm = &kernel_state.memory_mgr;
+    if (!stats) return;
+    
+    memset(stats, 0, sizeof(*stats));
+    stats->total_bytes = mm->total_memory;
+    stats->free_bytes = mm->free_pages << MEMORY_PAGE_SHIFT;
+    stats->free_runs = mm->free_runs;
+    stats->dirty_free_bytes = mm->dirty_pages << MEMORY_PAGE_SHIFT;
+    
+    // The largest run always sits on the highest non-empty list
+    if (mm->free_bitmap) {
+        unsigned order = memory_floor_order(mm->free_bitmap);
+        uint32_t largest = 0;
+        for (uint32_t index = mm->free_lists[order]; index != MEMORY_PAGE_NONE; index = mm->pages[index].next) {
+            if (mm->pages[index].run > largest) {
+                largest = mm->pages[index].run;
+            }
+        }
+        stats->largest_free_bytes = (size_t)largest << MEMORY_PAGE_SHIFT;
+    }
+    
+    if (stats->free_bytes > 0) {
+        stats->fragmentation = 1.0 - (double)stats->largest_free_bytes / (double)stats->free_bytes;
+    }
+}
+
+uint32_t memory_page_count(void) {
+    return kernel_state.memory_mgr.page_count;
+}
+
+uint32_t memory_page_index(const void* ptr) {
+    return (uint32_t)(((const uint8_t*)ptr - kernel_state.memory_mgr.arena) >> MEMORY_PAGE_SHIFT);
+}
+
+void* memory_page_address(uint32_t index) {
+    return kernel_state.memory_mgr.arena + ((size_t)index << MEMORY_PAGE_SHIFT);
+}
+
+// Only the slab allocator tags its pages, so a stray pointer into any
+// other one-page run is never mistaken for a slab object
+void memory_mark_slab(void* page, int slab) {
+    memory_page_t* tag = &kernel_state.memory_mgr.pages[memory_page_index(page)];
+    if (slab) {
+        tag->flags |= MEMORY_PAGE_SLAB;
+    } else {
+        tag->flags &= (uint8_t)~MEMORY_PAGE_SLAB;
+    }
+}
+
+void memory_cleanup(void) {
+    memory_manager_t* mm = &kernel_state.memory_mgr;
+    
+    kmem_cleanup();
+    
+    if (mm->arena) {
+        munmap(mm->arena, mm->total_memory);
+        mm->arena = NULL;
+    }
+    if (mm->pages) {
+        free(mm->pages);
+        mm->pages = NULL;
+    }
+    mm->page_count = 0;
+    mm->free_pages = 0;
+    mm->free_runs = 0;
+    mm->dirty_pages = 0;
+    mm->free_bitmap = 0;
+}
+
+// Scheduler Implementation
+//
+// Every CPU has its own MLFQ run queues under its own lock; there is no
+// scheduler-wide lock. Locks nest in this order: the kernel lock, a wait
+// queue, the timer lock, the process table, then CPU locks, two CPU locks
+// only in id order.
+
+// Processes move between host threads, so thread-local state is never read
+// through an address computed before a context switch
+static __attribute__((noinline)) scheduler_cpu_t* cpu_self(void) {
+    return this_cpu ? this_cpu : &kernel_state.scheduler.cpus[0];
+}
+
+static __attribute__((noinline)) process_context_t* context_self(void) {
+    return running_context;
+}
+
+static __attribute__((noinline)) void context_set_self(process_context_t* context) {
+    running_context = context;
+}
+
+// Execution contexts. A process runs on its own stack on whichever CPU
+// picked it, and every switch goes through that CPU's loop. The timer
+// signal is blocked whenever a context is saved, so a tick can never land
+// between deciding to switch and the switch itself; a tick arriving in
+// kernel context, or while the process has preemption off, only marks it
+// for rescheduling.
+static void context_leave(process_context_t* context) {
+    scheduler_cpu_t* cpu = cpu_self();
+    
+    if (context->kernel_depth) {
+        pthread_mutex_unlock(&kernel_lock);
+    }
+    context_set_self(NULL);
+    swapcontext(&context->uc, &cpu_hosts[cpu->id].context);
+    context_set_self(context);
+    if (context->kernel_depth) {
+        pthread_mutex_lock(&kernel_lock);
+    }
+}
+
+static void context_yield(process_context_t* context, int preempted) {
+    sigprocmask(SIG_BLOCK, &timer_signals, NULL);
+    context->preempted = preempted;
+    context_leave(context);
+    sigprocmask(SIG_UNBLOCK, &timer_signals, NULL);
+}
+
+// The timer signal is blocked in here, and stays blocked in the saved context
+static void scheduler_timer_handler(int signal_number) {
+    process_context_t* context = running_context;
+    (void)signal_number;
+    
+    if (!context) return;
+    if (context->preempt_count) {
+        context->need_resched = 1;
+        return;
+    }
+    
+    int saved_errno = errno;
+    context->preempted = 1;
+    context_leave(context);
+    errno = saved_errno;
+}
+
+static void preempt_off(void) {
+    process_context_t* context = context_self();
+    if (context) {
+        context->preempt_count++;
+    }
+}
+
+static void preempt_on(void) {
+    process_context_t* context = context_self();
+    if (!context || --context->preempt_count > 0 || !context->need_resched) return;
+    
+    context->need_resched = 0;
+    context_yield(context, 1);
+}
+
+// Kernel code run from process context must neither be preempted nor run
+// beside another CPU: a process switched out halfway through the allocator
+// or the page tables would leave them inconsistent. System calls that use
+// either enter the kernel on their own; the lock is dropped while a process
+// is switched out.
+void kernel_enter(void) {
+    process_context_t* context = context_self();
+    int* depth = context ? &context->kernel_depth : &kernel_depth;
+    
+    preempt_off();
+    if ((*depth)++ == 0) {
+        pthread_mutex_lock(&kernel_lock);
+    }
+}
+
+void kernel_leave(void) {
+    process_context_t* context = context_self();
+    int* depth = context ? &context->kernel_depth : &kernel_depth;
+    
+    if (--(*depth) == 0) {
+        pthread_mutex_unlock(&kernel_lock);
+    }
+    preempt_on();
+}
+
+// Background work from a CPU loop: skipped when another CPU is in the kernel
+static int kernel_try_enter(void) {
+    if (kernel_depth == 0 && pthread_mutex_trylock(&kernel_lock) != 0) return 0;
+    kernel_depth++;
+    return 1;
+}
+
+static void cpu_lock(scheduler_cpu_t* cpu) {
+    preempt_off();
+    pthread_mutex_lock(&cpu->lock);
+}
+
+static void cpu_unlock(scheduler_cpu_t* cpu) {
+    pthread_mutex_unlock(&cpu->lock);
+    preempt_on();
+}
+
+static void cpu_lock_pair(scheduler_cpu_t* a, scheduler_cpu_t* b) {
+    if (a == b) {
+        cpu_lock(a);
+    } else if (a->id < b->id) {
+        cpu_lock(a);
+        pthread_mutex_lock(&b->lock);
+    } else {
+        cpu_lock(b);
+        pthread_mutex_lock(&a->lock);
+    }
+}
+
+static void cpu_unlock_pair(scheduler_cpu_t* a, scheduler_cpu_t* b) {
+    if (a != b) {
+        pthread_mutex_unlock(&b->lock);
+    }
+    cpu_unlock(a);
+}
+
+// Like CPU locks, none of these is ever held across a switch: preemption
+// is off while a process holds one
+static void timer_lock_take(void) {
+    preempt_off();
+    pthread_mutex_lock(&timer_lock);
+}
+
+static void timer_lock_drop(void) {
+    pthread_mutex_unlock(&timer_lock);
+    preempt_on();
+}
+
+// Lookups share the table; only create and destroy change it. Holding it
+// keeps a process found in it from being freed.
+static void process_table_read(void) {
+    preempt_off();
+    pthread_rwlock_rdlock(&process_table_lock);
+}
+
+static void process_table_write(void) {
+    preempt_off();
+    pthread_rwlock_wrlock(&process_table_lock);
+}
+
+static void process_table_unlock(void) {
+    pthread_rwlock_unlock(&process_table_lock);
+    preempt_on();
+}
+
+static process_t* process_lookup(uint32_t pid) {
+    return pidmap_find(&kernel_state.scheduler.processes, pid);
+}
+
+// Lock the CPU that owns a process together with another one; stealing can
+// move the process while we wait
+static scheduler_cpu_t* process_lock_with(process_t* process, scheduler_cpu_t* other) {
+    for (;;) {
+        scheduler_cpu_t* cpu = &kernel_state.scheduler.cpus[__atomic_load_n(&process->cpu, __ATOMIC_ACQUIRE)];
+        cpu_lock_pair(cpu, other ? other : cpu);
+        if (process->cpu == cpu->id) return cpu;
+        cpu_unlock_pair(cpu, other ? other : cpu);
+    }
+}
+
+static scheduler_cpu_t* process_lock(process_t* process) {
+    return process_lock_with(process, NULL);
+}
+
+static void run_queue_push(scheduler_cpu_t* cpu, process_t* process) {
+    int level = process->priority;
+    
+    process->run_next = NULL;
+    process->run_prev = cpu->run_tail[level];
+    if (process->run_prev) {
+        process->run_prev->run_next = process;
+    } else {
+        cpu->run_head[level] = process;
+    }
+    cpu->run_tail[level] = process;
+    cpu->run_bitmap |= 1u << level;
+    __atomic_store_n(&cpu->ready, cpu->ready + 1, __ATOMIC_RELAXED);
+    if (process->context) {
+        __atomic_store_n(&cpu->runnable, cpu->runnable + 1, __ATOMIC_RELAXED);
+    }
+}
+
+static void run_queue_remove(scheduler_cpu_t* cpu, process_t* process) {
+    int level = process->priority;
+    
+    if (process->run_prev) {
+        process->run_prev->run_next = process->run_next;
+    } else {
+        cpu->run_head[level] = process->run_next;
+    }
+    if (process->run_next) {
+        process->run_next->run_prev = process->run_prev;
+    } else {
+        cpu->run_tail[level] = process->run_prev;
+    }
+    if (!cpu->run_head[level]) {
+        cpu->run_bitmap &= ~(1u << level);
+    }
+    process->run_prev = NULL;
+    process->run_next = NULL;
+    __atomic_store_n(&cpu->ready, cpu->ready - 1, __ATOMIC_RELAXED);
+    if (process->context) {
+        __atomic_store_n(&cpu->runnable, cpu->runnable - 1, __ATOMIC_RELAXED);
+    }
+}
+
+uint64_t scheduler_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Caller holds the CPU's lock and the process is on no run queue
+static void process_make_ready(scheduler_cpu_t* cpu, process_t* process) {
+    __atomic_store_n(&process->cpu, cpu->id, __ATOMIC_RELEASE);
+    process->state = PROCESS_READY;
+    process->ready_since_ns = scheduler_now_ns();
+    run_queue_push(cpu, process);
+    if (cpu->idle) {
+        pthread_cond_signal(&cpu->wake);
+    }
+}
+
+// Highest-level queued process the CPU can take; started_only passes over
+// processes without a context
+static process_t* run_queue_first(scheduler_cpu_t* cpu, int started_only) {
+    for (uint32_t levels = cpu->run_bitmap; levels; levels &= levels - 1) {
+        for (process_t* next = cpu->run_head[__builtin_ctz(levels)]; next; next = next->run_next) {
+            if (__atomic_load_n(&next->on_cpu, __ATOMIC_ACQUIRE)) continue; // Still leaving another CPU
+            if (started_only && !next->context) continue;
+            return next;
+        }
+    }
+    return NULL;
+}
+
+// Caller holds the CPU's lock. Put the running process back in line and
+// run the first one of the highest non-empty level.
+static void cpu_pick(scheduler_cpu_t* cpu, int started_only) {
+    process_t* current = cpu->current_process;
+    
+    if (current && current->state == PROCESS_RUNNING) {
+        process_make_ready(cpu, current);
+    }
+    
+    cpu->current_process = run_queue_first(cpu, started_only);
+    if (cpu->current_process) {
+        run_queue_remove(cpu, cpu->current_process);
+        cpu->current_process->state = PROCESS_RUNNING;
+    }
+}
+
+static void scheduler_pick(scheduler_cpu_t* cpu) {
+    cpu_lock(cpu);
+    cpu_pick(cpu, 0);
+    cpu_unlock(cpu);
+}
+
+// Anti-starvation: long-running batch work gets a fresh start at the top
+static void scheduler_boost(scheduler_cpu_t* cpu) {
+    for (int level = 1; level < SCHED_LEVELS; level++) {
+        while (cpu->run_head[level]) {
+            process_t* process = cpu->run_head[level];
+            run_queue_remove(cpu, process);
+            process->priority = 0;
+            process->ticks_used = 0;
+            run_queue_push(cpu, process);
+        }
+    }
+    if (cpu->current_process) {
+        cpu->current_process->priority = 0;
+        cpu->current_process->ticks_used = 0;
+    }
+}
+
+// Where a started process should queue when it becomes ready: its affinity
+// if it has one, else where it last ran unless another CPU sits idle, else
+// the online CPU with the shortest queue
+static scheduler_cpu_t* scheduler_place(process_t* process) {
+    scheduler_t* sched = &kernel_state.scheduler;
+    scheduler_cpu_t* last = &sched->cpus[__atomic_load_n(&process->cpu, __ATOMIC_RELAXED)];
+    
+    if (process->affinity >= 0 && (uint32_t)process->affinity < sched->cpu_count) {
+        return &sched->cpus[process->affinity];
+    }
+    if (!process->context || sched->cpu_count == 1) return last;
+    if (last->online && last->idle) return last;
+    
+    scheduler_cpu_t* best = last->online ? last : &sched->cpus[0];
+    for (uint32_t i = 0; i < sched->cpu_count; i++) {
+        scheduler_cpu_t* cpu = &sched->cpus[i];
+        if (!__atomic_load_n(&cpu->online, __ATOMIC_RELAXED)) continue;
+        if (__atomic_load_n(&cpu->idle, __ATOMIC_RELAXED)) return cpu;
+        if (__atomic_load_n(&cpu->ready, __ATOMIC_RELAXED) < __atomic_load_n(&best->ready, __ATOMIC_RELAXED)) {
+            best = cpu;
+        }
+    }
+    return best;
+}
+
+// Work was queued behind a running process; an idle CPU can steal it now
+// rather than at its next idle timeout
+// Idle CPUs sleep without a timeout, so anything that may give one work
+// kicks it. The sequence bump pairs with scheduler_idle: either the CPU sees
+// the new sequence and stays up, or the kick sees it idle and signals it.
+// Caller holds no CPU lock.
+static void scheduler_kick(void) {
+    scheduler_t* sched = &kernel_state.scheduler;
+    
+    __atomic_fetch_add(&sched->kick_seq, 1, __ATOMIC_SEQ_CST);
+    for (uint32_t i = 0; i < sched->cpu_count; i++) {
+        scheduler_cpu_t* cpu = &sched->cpus[i];
+        if (__atomic_load_n(&cpu->online, __ATOMIC_RELAXED) && __atomic_load_n(&cpu->idle, __ATOMIC_SEQ_CST)) {
+            cpu_lock(cpu);
+            pthread_cond_signal(&cpu->wake);
+            cpu_unlock(cpu);
+            return;
+        }
+    }
+}
+
+// scheduler_run returns once nothing started is ready or running; wake its
+// CPU when the last such process blocks or exits. Caller holds no CPU lock.
+static void scheduler_kick_main(void) {
+    scheduler_cpu_t* cpu = &kernel_state.scheduler.cpus[0];
+    
+    if (!__atomic_load_n(&kernel_state.scheduler.active, __ATOMIC_SEQ_CST)) {
+        cpu_lock(cpu);
+        pthread_cond_signal(&cpu->wake);
+        cpu_unlock(cpu);
+    }
+}
+
+// Caller holds the CPU's lock; the process is not executing anywhere
+static void process_detach(scheduler_cpu_t* cpu, process_t* process) {
+    if (process->state == PROCESS_READY) {
+        run_queue_remove(cpu, process);
+    }
+    if (process->context && (process->state == PROCESS_READY || process->state == PROCESS_RUNNING)) {
+        __atomic_fetch_sub(&kernel_state.scheduler.active, 1, __ATOMIC_RELAXED);
+    }
+    process->state = PROCESS_TERMINATED;
+    if (cpu->current_process == process) {
+        cpu->current_process = NULL;
+        if (cpu == cpu_self()) {
+            cpu_pick(cpu, 0);
+        }
+    }
+}
+
+static void process_context_free(process_t* process) {
+    process_context_t* context = process->context;
+    
+    mprotect(context->stack, MEMORY_PAGE_SIZE, PROT_READ | PROT_WRITE);
+    memory_free(context->stack);
+    memory_free(context);
+    process->context = NULL;
+    kernel_state.scheduler.context_count--;
+}
+
+// Take a ready or running process off the run queues. Caller holds the
+// process table lock or is the process itself. Returns 1 when it is the one
+// running on this CPU and still has to switch away, 0 when it was blocked
+// anywhere else, -1 if it was neither ready nor running.
+static int process_set_blocked(process_t* process) {
+    int result = -1;
+    
+    scheduler_cpu_t* cpu = process_lock(process);
+    if (process->state == PROCESS_READY || process->state == PROCESS_RUNNING) {
+        if (process->state == PROCESS_READY) {
+            run_queue_remove(cpu, process);
+            process->wait_ns += scheduler_now_ns() - process->ready_since_ns;
+            process->ready_since_ns = 0;
+        }
+        if (process->context) {
+            __atomic_fetch_sub(&kernel_state.scheduler.active, 1, __ATOMIC_RELAXED);
+        }
+        process->state = PROCESS_BLOCKED;
+        result = cpu->current_process == process && cpu == cpu_self();
+    }
+    cpu_unlock(cpu);
+    
+    if (result >= 0) {
+        scheduler_kick_main();
+    }
+    return result;
+}
+
+// Wait queues. Queue links live in the waiting process and change only under
+// the queue's lock, which a waiter holds until it is blocked, so a waker that
+// finds it queued finds it blocked. Waiters are off every run queue until
+// woken.
+void wait_queue_init(wait_queue_t* queue) {
+    pthread_mutex_init(&queue->lock, NULL);
+    queue->head = NULL;
+    queue->tail = NULL;
+    queue->count = 0;
+}
+
+static void wait_queue_lock(wait_queue_t* queue) {
+    preempt_off();
+    pthread_mutex_lock(&queue->lock);
+}
+
+static void wait_queue_unlock(wait_queue_t* queue) {
+    pthread_mutex_unlock(&queue->lock);
+    preempt_on();
+}
+
+static void wait_queue_append(wait_queue_t* queue, process_t* process) {
+    process->wait_queue = queue;
+    process->wait_prev = queue->tail;
+    process->wait_next = NULL;
+    if (queue->tail) {
+        queue->tail->wait_next = process;
+    } else {
+        queue->head = process;
+    }
+    queue->tail = process;
+    queue->count++;
+}
+
+static void wait_queue_remove(process_t* process) {
+    wait_queue_t* queue = process->wait_queue;
+    if (!queue) return;
+    
+    if (process->wait_prev) {
+        process->wait_prev->wait_next = process->wait_next;
+    } else {
+        queue->head = process->wait_next;
+    }
+    if (process->wait_next) {
+        process->wait_next->wait_prev = process->wait_prev;
+    } else {
+        queue->tail = process->wait_prev;
+    }
+    __atomic_store_n(&process->wait_queue, NULL, __ATOMIC_RELEASE);
+    process->wait_prev = NULL;
+    process->wait_next = NULL;
+    queue->count--;
+}
+
+// Only wakers race to take a process that no longer runs off its queue
+static void wait_queue_drop(process_t* process) {
+    wait_queue_t* queue = __atomic_load_n(&process->wait_queue, __ATOMIC_ACQUIRE);
+    if (!queue) return;
+    
+    wait_queue_lock(queue);
+    if (process->wait_queue == queue) {
+        wait_queue_remove(process);
+    }
+    wait_queue_unlock(queue);
+}
+
+// Block the calling process on queue until woken or timeout_ms passes (0
+// waits forever). Caller holds the queue's lock; it is dropped while the
+// process is out and held again on return. Returns 0 when woken through the
+// queue, -1 on timeout.
+static int wait_queue_block(wait_queue_t* queue, process_t* self, unsigned timeout_ms) {
+    wait_queue_append(queue, self);
+    process_set_blocked(self);
+    if (timeout_ms) {
+        kernel_timer_start(&self->sleep_timer, timeout_ms);
+    }
+    wait_queue_unlock(queue);
+    process_switch(); // Returns once woken
+    if (timeout_ms) {
+        kernel_timer_cancel(&self->sleep_timer);
+    }
+    wait_queue_lock(queue);
+    
+    // Still queued: the timeout or a stray process_wake got here first
+    if (self->wait_queue) {
+        wait_queue_remove(self);
+        return -1;
+    }
+    return 0;
+}
+
+int wait_queue_wait(wait_queue_t* queue, unsigned timeout_ms) {
+    process_t* self = process_get_current();
+    if (!queue || !context_self() || !self) return -1;
+    
+    wait_queue_lock(queue);
+    int result = wait_queue_block(queue, self, timeout_ms);
+    wait_queue_unlock(queue);
+    return result;
+}
+
+// Wake up to count waiters, oldest first; returns how many were woken
+size_t wait_queue_wake(wait_queue_t* queue, size_t count) {
+    size_t woken = 0;
+    if (!queue) return 0;
+    
+    wait_queue_lock(queue);
+    while (queue->head && woken < count) {
+        process_t* process = queue->head;
+        wait_queue_remove(process);
+        process_wake(process->pid);
+        woken++;
+    }
+    wait_queue_unlock(queue);
+    return woken;
+}
+
+// Futexes: one wait queue per hash bucket, shared by every key that lands
+// in it and locked on its own. Only waiters exist in the table; a futex
+// nobody waits on costs nothing. Keys are private to an address space, so clones that share pages
+// copy-on-write do not share futexes.
+static wait_queue_t futex_buckets[FUTEX_BUCKETS];
+
+static wait_queue_t* futex_bucket(const address_space_t* space, vaddr_t addr) {
+    uint64_t key = ((uint64_t)(uintptr_t)space << 16) ^ (addr >> 2);
+    key *= 0x9e3779b97f4a7c15ull;
+    return &futex_buckets[(key >> 32) & (FUTEX_BUCKETS - 1)];
+}
+
+// Block while the word at addr holds value. The word is read with the
+// bucket locked and under the kernel lock, which the store that changes it
+// needs as well, so the wake after that store cannot be missed. Returns 0
+// when woken, -1 if the word differs, addr is not mapped, or timeout_ms
+// passed.
+int futex_wait(vaddr_t addr, uint32_t value, unsigned timeout_ms) {
+    process_t* self = process_get_current();
+    if (!context_self() || !self || (addr & 3)) return -1;
+    
+    wait_queue_t* bucket = futex_bucket(self->address_space, addr);
+    uint32_t current;
+    kernel_enter();
+    wait_queue_lock(bucket);
+    int same = paging_read(self->address_space, addr, &current, sizeof(current)) == sizeof(current) &&
+               current == value;
+    kernel_leave();
+    
+    int result = -1;
+    if (same) {
+        self->futex_addr = addr;
+        result = wait_queue_block(bucket, self, timeout_ms);
+    }
+    wait_queue_unlock(bucket);
+    return result;
+}
+
+// Wake up to count waiters on addr in the caller's address space; returns
+// how many were woken
+int futex_wake(vaddr_t addr, size_t count) {
+    process_t* self = process_get_current();
+    if (!self || (addr & 3)) return -1;
+    
+    wait_queue_t* bucket = futex_bucket(self->address_space, addr);
+    wait_queue_lock(bucket);
+    process_t* process = bucket->head;
+    size_t woken = 0;
+    while (process && woken < count) {
+        process_t* next = process->wait_next;
+        if (process->address_space == self->address_space && process->futex_addr == addr) {
+            wait_queue_remove(process);
+            process_wake(process->pid);
+            woken++;
+        }
+        process = next;
+    }
+    wait_queue_unlock(bucket);
+    return (int)woken;
+}
+
+// Page messages. Envelopes queue on the receiver until process_page_receive
+// takes them; grants stay in a table by handle until revoked.
+typedef struct page_envelope {
+    page_message_t message;
+    struct page_envelope* next;
+} page_envelope_t;
+
+typedef struct {
+    uint32_t sender;
+    uint32_t receiver;
+    vaddr_t addr; // In the receiver
+    size_t pages;
+} page_grant_t;
+
+// Transfer window space. Each receiver keeps a bitmap of the window pages
+// in use; a search starts where the last one ended and wraps around once.
+#define TRANSFER_PAGES (PROCESS_TRANSFER_SIZE >> PAGING_PAGE_SHIFT)
+
+static size_t transfer_search(const uint64_t* map, size_t from, size_t pages) {
+    size_t run = 0;
+    for (size_t i = from; i < TRANSFER_PAGES; i++) {
+        if ((i & 63) == 0 && map[i >> 6] == UINT64_MAX) {
+            run = 0;
+            i += 63;
+        } else if (map[i >> 6] & (1ull << (i & 63))) {
+            run = 0;
+        } else if (++run == pages) {
+            return i + 1 - pages;
+        }
+    }
+    return TRANSFER_PAGES;
+}
+
+// Caller holds the kernel lock. Returns where the pages go, or 0 when the
+// window has no free run that long.
+static vaddr_t transfer_alloc(process_t* process, size_t pages) {
+    if (!process->transfer_map) {
+        process->transfer_map = calloc(TRANSFER_PAGES / 64, sizeof(uint64_t));
+        if (!process->transfer_map) return 0;
+    }
+    
+    size_t first = transfer_search(process->transfer_map, process->transfer_next, pages);
+    if (first == TRANSFER_PAGES) {
+        first = transfer_search(process->transfer_map, 0, pages);
+        if (first == TRANSFER_PAGES) return 0;
+    }
+    for (size_t i = first; i < first + pages; i++) {
+        process->transfer_map[i >> 6] |= 1ull << (i & 63);
+    }
+    process->transfer_next = first + pages;
+    return PROCESS_TRANSFER_BASE + (vaddr_t)(first << PAGING_PAGE_SHIFT);
+}
+
+// Caller holds the kernel lock. Unmaps whatever part of the range lies in
+// the window and gives that space back; the rest is left alone.
+static void transfer_release(process_t* process, vaddr_t addr, size_t pages) {
+    uint64_t start = addr;
+    uint64_t end = start + ((uint64_t)pages << PAGING_PAGE_SHIFT);
+    if (start < PROCESS_TRANSFER_BASE) start = PROCESS_TRANSFER_BASE;
+    if (end > (uint64_t)PROCESS_TRANSFER_BASE + PROCESS_TRANSFER_SIZE) {
+        end = (uint64_t)PROCESS_TRANSFER_BASE + PROCESS_TRANSFER_SIZE;
+    }
+    if (!process->transfer_map || start >= end) return;
+    
+    size_t first = (size_t)((start - PROCESS_TRANSFER_BASE) >> PAGING_PAGE_SHIFT);
+    size_t count = (size_t)((end - start) >> PAGING_PAGE_SHIFT);
+    paging_unmap(process->address_space, (vaddr_t)start, count);
+    for (size_t i = first; i < first + count; i++) {
+        process->transfer_map[i >> 6] &= ~(1ull << (i & 63));
+    }
+}
+
+// Caller holds the kernel lock. Grant mappings only go away with the grant.
+static int page_grant_overlaps(uint32_t receiver, vaddr_t addr, size_t pages) {
+    size_t cursor = 0;
+    uint32_t id;
+    page_grant_t* grant;
+    while ((grant = pidmap_next(&page_grants, &cursor, &id))) {
+        if (grant->receiver == receiver && addr < grant->addr + (grant->pages << PAGING_PAGE_SHIFT) &&
+            grant->addr < addr + (pages << PAGING_PAGE_SHIFT)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Caller holds the kernel lock
+static void page_grant_release(uint32_t id, page_grant_t* grant) {
+    pidmap_remove(&page_grants, id);
+    process_t* receiver = process_find(grant->receiver);
+    if (receiver) {
+        transfer_release(receiver, grant->addr, grant->pages);
+    }
+    kmem_cache_free(grant_cache, grant);
+}
+
+// Map the pages at addr into pid's transfer window and queue a message for
+// it. Nothing is copied: a move relinks the frames, a grant adds read-only
+// mappings and makes the sender's copy-on-write. Moving pages on out of the
+// sender's own window frees that space. Returns the grant handle, 0 for a
+// move, or -1.
+int64_t process_page_send(uint32_t pid, vaddr_t addr, size_t size, int flags) {
+    process_t* self = process_get_current();
+    if (!self || size == 0 || size > PROCESS_TRANSFER_SIZE || (addr & (PAGING_PAGE_SIZE - 1)) ||
+        (flags != PAGE_SEND_MOVE && flags != PAGE_SEND_GRANT)) {
+        return -1;
+    }
+    size_t pages = (size + PAGING_PAGE_SIZE - 1) >> PAGING_PAGE_SHIFT;
+    int64_t result = -1;
+    
+    kernel_enter();
+    process_t* receiver = process_find(pid);
+    page_envelope_t* envelope = kmem_cache_alloc(envelope_cache);
+    page_grant_t* grant = flags == PAGE_SEND_GRANT ? kmem_cache_alloc(grant_cache) : NULL;
+    if (!receiver || !envelope || (flags == PAGE_SEND_GRANT && !grant) ||
+        (flags == PAGE_SEND_MOVE && page_grant_overlaps(self->pid, addr, pages))) {
+        goto out;
+    }
+    
+    vaddr_t dst = transfer_alloc(receiver, pages);
+    if (!dst) goto out;
+    int mode = flags == PAGE_SEND_GRANT ? PAGING_TRANSFER_GRANT : PAGING_TRANSFER_MOVE;
+    if (paging_transfer(self->address_space, addr, receiver->address_space, dst, pages, mode) != 0) {
+        transfer_release(receiver, dst, pages);
+        goto out;
+    }
+    
+    uint32_t id = 0;
+    if (grant) {
+        id = next_grant++;
+        if (next_grant == 0) next_grant = 1;
+        grant->sender = self->pid;
+        grant->receiver = pid;
+        grant->addr = dst;
+        grant->pages = pages;
+        if (pidmap_insert(&page_grants, id, grant) != 0) {
+            transfer_release(receiver, dst, pages);
+            goto out;
+        }
+        grant = NULL;
+    } else {
+        transfer_release(self, addr, pages); // Only demand-zero entries are left there
+    }
+    
+    envelope->message.sender = self->pid;
+    envelope->message.grant = id;
+    envelope->message.addr = dst;
+    envelope->message.size = (uint32_t)size;
+    envelope->next = NULL;
+    if (receiver->mailbox_tail) {
+        receiver->mailbox_tail->next = envelope;
+    } else {
+        receiver->mailbox_head = envelope;
+    }
+    receiver->mailbox_tail = envelope;
+    envelope = NULL;
+    
+    wait_queue_wake(&receiver->mailbox, 1);
+    result = id;
+
+out:
+    if (envelope) kmem_cache_free(envelope_cache, envelope);
+    if (grant) kmem_cache_free(grant_cache, grant);
+    kernel_leave();
+    return result;
+}
+
+// Take the oldest page message, waiting up to timeout_ms (0 waits forever)
+// when the mailbox is empty. Returns 0, or -1 on timeout.
+int process_page_receive(page_message_t* message, unsigned timeout_ms) {
+    process_t* self = process_get_current();
+    if (!self || !message) return -1;
+    
+    kernel_enter();
+    int result = 0;
+    while (!self->mailbox_head && result == 0) {
+        if (!context_self()) {
+            result = -1;
+            break;
         }
+        
+        // Senders queue under the kernel lock, which is only dropped once
+        // this process is on the mailbox queue
+        wait_queue_lock(&self->mailbox);
+        result = wait_queue_block(&self->mailbox, self, timeout_ms);
+        wait_queue_unlock(&self->mailbox);
     }
     
-    return 256 * 1024 * 1024; // Default fallback
+    page_envelope_t* envelope = self->mailbox_head;
+    if (envelope) {
+        self->mailbox_head = envelope->next;
+        if (!self->mailbox_head) {
+            self->mailbox_tail = NULL;
+        }
+        *message = envelope->message;
+        kmem_cache_free(envelope_cache, envelope);
+        result = 0;
+    }
+    kernel_leave();
+    return result;
 }
 
-int kernel_init(mindose_config_t* config) {
-    printf("Kernel: Initializing core systems...\n");
+// End a grant: the receiver's mappings go away, and the sender's pages are
+// private again. Either side may revoke.
+int process_page_revoke(uint32_t id) {
+    process_t* self = process_get_current();
+    int result = -1;
     
-    // Initialize memory management
-    size_t mem_size = parse_memory_size(config->mem_size);
-    if (memory_init(mem_size) != 0) {
-        fprintf(stderr, "Kernel: Failed to initialize memory management\n");
+    kernel_enter();
+    page_grant_t* grant = pidmap_find(&page_grants, id);
+    if (grant && (!self || self->pid == grant->sender || self->pid == grant->receiver)) {
+        page_grant_release(id, grant);
+        result = 0;
+    }
+    kernel_leave();
+    return result;
+}
+
+// Give back received pages the caller is done with. Granted pages have to
+// be revoked instead.
+int process_page_release(vaddr_t addr, size_t size) {
+    process_t* self = process_get_current();
+    if (!self || size == 0 || (addr & (PAGING_PAGE_SIZE - 1)) || addr < PROCESS_TRANSFER_BASE ||
+        size > PROCESS_TRANSFER_SIZE - (addr - PROCESS_TRANSFER_BASE)) {
         return -1;
     }
+    size_t pages = (size + PAGING_PAGE_SIZE - 1) >> PAGING_PAGE_SHIFT;
+    int result = -1;
     
-    // Initialize scheduler
-    if (scheduler_init() != 0) {
-        fprintf(stderr, "Kernel: Failed to initialize scheduler\n");
-        return -1;
+    kernel_enter();
+    if (!page_grant_overlaps(self->pid, addr, pages)) {
+        transfer_release(self, addr, pages);
+        result = 0;
+    }
+    kernel_leave();
+    return result;
+}
+
+// Caller holds the kernel lock; the process is already out of the table,
+// so grants it received are not unmapped from its dying space
+static void process_page_cleanup(process_t* process) {
+    while (process->mailbox_head) {
+        page_envelope_t* envelope = process->mailbox_head;
+        process->mailbox_head = envelope->next;
+        kmem_cache_free(envelope_cache, envelope);
     }
+    process->mailbox_tail = NULL;
     
-    // Initialize device management
-    if (device_init(config) != 0) {
-        fprintf(stderr, "Kernel: Failed to initialize device management\n");
-        return -1;
+    // Grants end with either side; restart the walk after each removal
+    size_t cursor = 0;
+    uint32_t id;
+    page_grant_t* grant;
+    while ((grant = pidmap_next(&page_grants, &cursor, &id))) {
+        if (grant->sender == process->pid || grant->receiver == process->pid) {
+            page_grant_release(id, grant);
+            cursor = 0;
+        }
     }
     
-    kernel_state.initialized = 1;
-    printf("Kernel: Initialization complete\n");
-    return 0;
+    free(process->transfer_map);
+    process->transfer_map = NULL;
 }
 
-void kernel_cleanup(void) {
-    if (!kernel_state.initialized) return;
+// Caller holds the kernel lock and has detached the process. Once it is out
+// of the table, off its wait queue and its timer is cancelled, nothing in the
+// scheduler can reach it any more.
+static void process_destroy(process_t* process) {
+    uint32_t pid = process->pid;
     
-    printf("Kernel: Shutting down...\n");
-    device_cleanup();
-    memory_cleanup();
-    kernel_state.initialized = 0;
+    process_table_write();
+    pidmap_remove(&kernel_state.scheduler.processes, pid);
+    process_table_unlock();
+    wait_queue_drop(process);
+    process_page_cleanup(process);
+    kernel_timer_cancel(&process->sleep_timer);
+    if (process->context) {
+        process_context_free(process);
+    }
+    
+    // Releases every process_memory_alloc allocation with the address space
+    paging_destroy_space(process->address_space);
+    kmem_cache_free(process_cache, process);
+    printf("Process: Terminated PID %u\n", pid);
+    
+    // Anything still attributed to the process now is a leak
+    if (kernel_state.memory_mgr.tracing) {
+        memtrace_check_leaks(pid);
+    }
 }
 
-// Memory Management Implementation
-int memory_init(size_t total_size) {
-    kernel_state.memory_mgr.total_memory = total_size;
-    kernel_state.memory_mgr.block_count = 1024; // Max blocks
+static void process_trampoline(void) {
+    process_context_t* context = cpu_self()->current_process->context;
     
-    kernel_state.memory_mgr.blocks = malloc(sizeof(memory_block_t) * kernel_state.memory_mgr.block_count);
-    if (!kernel_state.memory_mgr.blocks) {
-        return -1;
+    context_set_self(context);
+    sigprocmask(SIG_UNBLOCK, &timer_signals, NULL);
+    context->entry(context->arg);
+    process_exit();
+}
+
+// Give a process a stack and a host context; entry runs once a CPU picks
+// the process, and returning from it terminates the process
+int process_start(uint32_t pid, process_entry_t entry, void* arg) {
+    int result = -1;
+    
+    kernel_enter();
+    process_t* process = process_find(pid);
+    process_context_t* context = NULL;
+    if (!process || process->context || !entry) goto out;
+    
+    context = memory_alloc(sizeof(process_context_t));
+    if (!context) goto out;
+    memset(context, 0, sizeof(*context));
+    
+    context->stack = memory_alloc_aligned(PROCESS_STACK_SIZE, MEMORY_PAGE_SIZE);
+    if (!context->stack) {
+        memory_free(context);
+        goto out;
     }
     
-    // Initialize first block as free memory
-    kernel_state.memory_mgr.blocks[0].base_addr = malloc(total_size);
-    kernel_state.memory_mgr.blocks[0].size = total_size;
-    kernel_state.memory_mgr.blocks[0].is_allocated = 0;
+    // An overflow faults on the guard page instead of running into the arena
+    if (mprotect(context->stack, MEMORY_PAGE_SIZE, PROT_NONE) != 0 ||
+        getcontext(&context->uc) != 0) {
+        memory_free(context->stack);
+        memory_free(context);
+        goto out;
+    }
+    context->uc.uc_stack.ss_sp = context->stack;
+    context->uc.uc_stack.ss_size = PROCESS_STACK_SIZE;
+    context->uc.uc_link = NULL;
+    sigaddset(&context->uc.uc_sigmask, SIGVTALRM);
+    makecontext(&context->uc, process_trampoline, 0);
+    context->entry = entry;
+    context->arg = arg;
     
-    if (!kernel_state.memory_mgr.blocks[0].base_addr) {
-        free(kernel_state.memory_mgr.blocks);
-        return -1;
+    // Stealing only looks at started processes, so publish under the lock
+    scheduler_cpu_t* cpu = process_lock(process);
+    process->context = context;
+    if (process->state == PROCESS_READY) {
+        __atomic_store_n(&cpu->runnable, cpu->runnable + 1, __ATOMIC_RELAXED);
+    }
+    if (process->state == PROCESS_READY || process->state == PROCESS_RUNNING) {
+        __atomic_fetch_add(&kernel_state.scheduler.active, 1, __ATOMIC_RELAXED);
+    }
+    cpu_unlock(cpu);
+    kernel_state.scheduler.context_count++;
+    result = 0;
+
+out:
+    kernel_leave();
+    if (result == 0) {
+        scheduler_kick();
+    }
+    return result;
+}
+
+// Called from process context; the CPU's loop terminates the process
+void process_exit(void) {
+    process_context_t* context = context_self();
+    if (!context) return;
+    
+    sigprocmask(SIG_BLOCK, &timer_signals, NULL);
+    context->exited = 1;
+    context_leave(context);
+}
+
+// Soft affinity: the process is queued on that CPU whenever it becomes
+// ready, and other CPUs only steal it while that CPU is offline
+int process_set_affinity(uint32_t pid, int cpu_id) {
+    if (cpu_id < -1 || cpu_id >= SCHED_MAX_CPUS) return -1;
+    
+    process_table_read();
+    process_t* process = process_lookup(pid);
+    if (process) {
+        scheduler_cpu_t* cpu = process_lock(process);
+        process->affinity = cpu_id;
+        cpu_unlock(cpu);
+    }
+    process_table_unlock();
+    return process ? 0 : -1;
+}
+
+// Kernel timers. Expired timers run on whichever CPU notices them first: at
+// the top of its loop, or when its idle wait for the next expiry ends. They
+// run under the timer lock, so a timer cancelled with its owner never fires
+// after the owner is gone; their functions may wake processes, but must not
+// take the kernel lock or a wait queue's or touch the wheel.
+static void scheduler_run_timers(void) {
+    if (__atomic_load_n(&timer_next, __ATOMIC_ACQUIRE) > timer_now_tick()) return;
+    
+    timer_lock_take();
+    wheel_timer_t* expired = timer_wheel_advance(&timer_wheel, timer_now_tick());
+    timer_update_next();
+    timer_wheel_run(expired);
+    timer_lock_drop();
+}
+
+// Fires no earlier than delay_ms from now; restarting a pending timer moves it
+void kernel_timer_start(wheel_timer_t* timer, uint64_t delay_ms) {
+    timer_lock_take();
+    uint64_t previous = __atomic_load_n(&timer_next, __ATOMIC_RELAXED);
+    timer_wheel_add(&timer_wheel, timer, timer_now_tick() + delay_ms + 1);
+    timer_update_next();
+    int earlier = __atomic_load_n(&timer_next, __ATOMIC_RELAXED) < previous;
+    timer_lock_drop();
+    
+    // An idle CPU may be sleeping past the new deadline
+    if (earlier) {
+        scheduler_kick();
+    }
+}
+
+// Returns 1 if the timer was pending
+int kernel_timer_cancel(wheel_timer_t* timer) {
+    timer_lock_take();
+    int pending = timer_wheel_cancel(&timer_wheel, timer);
+    if (pending) {
+        timer_update_next();
     }
+    timer_lock_drop();
+    return pending;
+}
+
+static void process_sleep_expired(void* arg) {
+    process_wake((uint32_t)(uintptr_t)arg);
+}
+
+// Block the calling process for at least ms milliseconds. The process is
+// blocked before the timer is armed, so an expiry that comes before the
+// switch still wakes it.
+int process_sleep(unsigned ms) {
+    process_t* self = process_get_current();
+    if (!context_self() || !self) return -1;
     
-    printf("Memory: Initialized %zu bytes\n", total_size);
+    preempt_off();
+    process_set_blocked(self);
+    kernel_timer_start(&self->sleep_timer, ms);
+    preempt_on();
+    process_switch();
+    kernel_timer_cancel(&self->sleep_timer); // Woken early by someone else
     return 0;
 }
 
-void* memory_alloc(size_t size) {
-    // Simple first-fit allocation
-    for (size_t i = 0; i < kernel_state.memory_mgr.block_count; i++) {
-        memory_block_t* block = &kernel_state.memory_mgr.blocks[i];
+// CPU accounting, under the lock of the CPU running the process. A run
+// starts when on_cpu is set and ends once its CPU has switched away.
+static void process_account_start(process_t* process) {
+    uint64_t now = scheduler_now_ns();
+    
+    if (process->ready_since_ns) {
+        process->wait_ns += now - process->ready_since_ns;
+        process->ready_since_ns = 0;
+    }
+    process->last_run_ns = now;
+}
+
+static void process_account_stop(process_t* process, int preempted) {
+    process->run_ns += scheduler_now_ns() - process->last_run_ns;
+    if (preempted) {
+        process->involuntary_switches++;
+    } else {
+        process->voluntary_switches++;
+    }
+}
+
+// A started process of this CPU's, the one that was running if it still may
+static process_t* scheduler_pick_started(scheduler_cpu_t* cpu) {
+    cpu_lock(cpu);
+    process_t* current = cpu->current_process;
+    if (!current || current->state != PROCESS_RUNNING || !current->context) {
+        cpu_pick(cpu, 1);
+        current = cpu->current_process;
+    }
+    if (current) {
+        __atomic_store_n(&current->on_cpu, 1, __ATOMIC_RELAXED);
+        process_account_start(current);
+    }
+    cpu_unlock(cpu);
+    return current;
+}
+
+// Take the most urgent started process from the CPU with the longest queue
+static process_t* scheduler_steal(scheduler_cpu_t* thief) {
+    scheduler_t* sched = &kernel_state.scheduler;
+    scheduler_cpu_t* victim = NULL;
+    uint32_t most = 0;
+    
+    for (uint32_t i = 0; i < sched->cpu_count; i++) {
+        uint32_t ready = __atomic_load_n(&sched->cpus[i].runnable, __ATOMIC_RELAXED);
+        if (&sched->cpus[i] != thief && ready > most) {
+            victim = &sched->cpus[i];
+            most = ready;
+        }
+    }
+    if (!victim) return NULL;
+    
+    process_t* process = NULL;
+    cpu_lock_pair(thief, victim);
+    for (uint32_t levels = victim->run_bitmap; levels && !process; levels &= levels - 1) {
+        for (process_t* next = victim->run_head[__builtin_ctz(levels)]; next; next = next->run_next) {
+            if (!next->context || __atomic_load_n(&next->on_cpu, __ATOMIC_ACQUIRE)) continue;
+            if (next->affinity == victim->id && victim->online) continue;
+            process = next;
+            break;
+        }
+    }
+    if (process && !thief->current_process) {
+        run_queue_remove(victim, process);
+        __atomic_store_n(&process->cpu, thief->id, __ATOMIC_RELEASE);
+        process->state = PROCESS_RUNNING;
+        __atomic_store_n(&process->on_cpu, 1, __ATOMIC_RELAXED);
+        process_account_start(process);
+        thief->current_process = process;
+        thief->steals++;
+    } else {
+        process = NULL;
+    }
+    cpu_unlock_pair(thief, victim);
+    return process;
+}
+
+// True once the main loop has nothing left to wait for: no process is
+// ready or running on a worker and no timer could wake one
+static int scheduler_done(void) {
+    return (!workers_running || !__atomic_load_n(&kernel_state.scheduler.active, __ATOMIC_SEQ_CST)) &&
+           __atomic_load_n(&timer_next, __ATOMIC_ACQUIRE) == TIMER_WHEEL_NONE;
+}
+
+// Nothing to run or steal: sleep until work is queued here, a kick arrives
+// or the next timer is due. seq is the kick sequence read before looking for
+// work; the main loop also stays up once nothing is left for it to wait for.
+static void scheduler_idle(scheduler_cpu_t* cpu, uint32_t seq, int main_loop) {
+    scheduler_t* sched = &kernel_state.scheduler;
+    
+    pthread_mutex_lock(&cpu->lock);
+    __atomic_store_n(&cpu->idle, 1, __ATOMIC_SEQ_CST);
+    if (!cpu->runnable && !__atomic_load_n(&sched->stopping, __ATOMIC_ACQUIRE) &&
+        __atomic_load_n(&sched->kick_seq, __ATOMIC_SEQ_CST) == seq &&
+        !(main_loop && scheduler_done())) {
+        uint64_t next = __atomic_load_n(&timer_next, __ATOMIC_ACQUIRE);
+        if (next == TIMER_WHEEL_NONE) {
+            pthread_cond_wait(&cpu->wake, &cpu->lock);
+        } else if (next > timer_now_tick()) {
+            uint64_t deadline = next * KERNEL_TIMER_TICK_NS;
+            struct timespec ts;
+            ts.tv_sec = (time_t)(deadline / 1000000000ull);
+            ts.tv_nsec = (long)(deadline % 1000000000ull);
+            pthread_cond_timedwait(&cpu->wake, &cpu->lock, &ts);
+        }
+    }
+    __atomic_store_n(&cpu->idle, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&cpu->lock);
+}
+
+// A CPU's loop. Workers run until the CPUs are stopped; scheduler_run
+// returns once no started process is ready or running anywhere.
+static size_t scheduler_cpu_loop(scheduler_cpu_t* cpu, int worker) {
+    scheduler_t* sched = &kernel_state.scheduler;
+    size_t switches = 0;
+    
+    __atomic_store_n(&cpu->online, 1, __ATOMIC_RELEASE);
+    while (!worker || !__atomic_load_n(&sched->stopping, __ATOMIC_ACQUIRE)) {
+        uint32_t seq = __atomic_load_n(&sched->kick_seq, __ATOMIC_SEQ_CST);
+        scheduler_run_timers();
+        process_t* process = scheduler_pick_started(cpu);
+        if (!process) {
+            process = scheduler_steal(cpu);
+        }
+        if (!process) {
+            if (!worker && scheduler_done()) break;
+            scheduler_idle(cpu, seq, !worker);
+            continue;
+        }
+        
+        // More started work queued here than this CPU can run: let an idle
+        // CPU come and steal it
+        if (sched->cpu_count > 1 && __atomic_load_n(&cpu->runnable, __ATOMIC_RELAXED)) {
+            scheduler_kick();
+        }
+        
+        process_context_t* context = process->context;
+        if (!__atomic_load_n(&process->killed, __ATOMIC_RELAXED)) {
+            context->preempted = 0;
+            cpu->switches++;
+            switches++;
+            swapcontext(&cpu_hosts[cpu->id].context, &context->uc);
+        }
         
-        if (!block->is_allocated && block->size >= size && block->base_addr) {
-            if (block->size > size) {
-                // Split block if it's larger than needed
-                for (size_t j = 0; j < kernel_state.memory_mgr.block_count; j++) {
-                    if (!kernel_state.memory_mgr.blocks[j].base_addr) {
-                        kernel_state.memory_mgr.blocks[j].base_addr = (char*)block->base_addr + size;
-                        kernel_state.memory_mgr.blocks[j].size = block->size - size;
-                        kernel_state.memory_mgr.blocks[j].is_allocated = 0;
-                        break;
-                    }
-                }
-                block->size = size;
+        // Until on_cpu drops, nobody else touches the process. A wake-up
+        // may already have queued it on another CPU.
+        scheduler_cpu_t* owner = process_lock_with(process, cpu);
+        int exited = context->exited || process->killed;
+        int preempted = context->preempted;
+        process_account_stop(process, preempted);
+        if (cpu->current_process == process && owner != cpu) {
+            cpu->current_process = NULL;
+        }
+        if (exited) {
+            process_detach(owner, process);
+        } else {
+            __atomic_store_n(&process->on_cpu, 0, __ATOMIC_RELEASE);
+            if (owner != cpu) {
+                pthread_cond_signal(&owner->wake); // It may have gone idle while the process was leaving
             }
-            
-            block->is_allocated = 1;
-            return block->base_addr;
+        }
+        cpu_unlock_pair(owner, cpu);
+        
+        if (exited) {
+            kernel_enter();
+            process_destroy(process);
+            kernel_leave();
+            scheduler_kick_main();
+        } else if (preempted) {
+            cpu->preemptions++;
+            scheduler_tick();
+        } else {
+            process_switch();
         }
     }
     
-    return NULL; // No suitable block found
+    // Leave nothing marked running on a CPU that goes offline
+    __atomic_store_n(&cpu->online, 0, __ATOMIC_RELEASE);
+    cpu_lock(cpu);
+    if (cpu->current_process && cpu->current_process->state == PROCESS_RUNNING) {
+        process_make_ready(cpu, cpu->current_process);
+    }
+    cpu->current_process = NULL;
+    cpu_unlock(cpu);
+    return switches;
 }
 
-void memory_free(void* ptr) {
-    for (size_t i = 0; i < kernel_state.memory_mgr.block_count; i++) {
-        if (kernel_state.memory_mgr.blocks[i].base_addr == ptr) {
-            kernel_state.memory_mgr.blocks[i].is_allocated = 0;
-            // TODO: Implement block coalescing
-            return;
+// Run started processes on the calling thread's CPU until none is ready or
+// running; returns the number of switches into a process
+size_t scheduler_run(void) {
+    if (context_self()) return 0;
+    return scheduler_cpu_loop(cpu_self(), 0);
+}
+
+// Each CPU has its own timer on its thread's CPU clock, so ticks measure the
+// time that CPU spent running processes
+static int cpu_arm_timer(uint32_t id) {
+    cpu_host_t* host = &cpu_hosts[id];
+    
+    if (host->timer_armed) {
+        timer_delete(host->timer);
+        host->timer_armed = 0;
+    }
+    if (!timer_interval_us) return 0;
+    
+    clockid_t clock;
+    struct sigevent event;
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGVTALRM;
+    event.sigev_notify_thread_id = host->tid;
+    if (pthread_getcpuclockid(host->thread, &clock) != 0 ||
+        timer_create(clock, &event, &host->timer) != 0) {
+        return -1;
+    }
+    host->timer_armed = 1;
+    
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = timer_interval_us / 1000000;
+    spec.it_interval.tv_nsec = (long)(timer_interval_us % 1000000) * 1000;
+    spec.it_value = spec.it_interval;
+    return timer_settime(host->timer, 0, &spec, NULL);
+}
+
+// Preempt processes every interval_us of CPU time; zero stops the timers
+int scheduler_set_timer(unsigned interval_us) {
+    scheduler_t* sched = &kernel_state.scheduler;
+    int result = 0;
+    
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    action.sa_handler = scheduler_timer_handler;
+    if (interval_us && sigaction(SIGVTALRM, &action, NULL) != 0) return -1;
+    
+    pthread_mutex_lock(&cpu_hosts_lock);
+    timer_interval_us = interval_us;
+    for (uint32_t i = 0; i < sched->cpu_count; i++) {
+        if ((i == 0 || sched->cpus[i].online) && cpu_arm_timer(i) != 0) {
+            result = -1;
         }
     }
+    pthread_mutex_unlock(&cpu_hosts_lock);
+    
+    if (!interval_us) {
+        action.sa_handler = SIG_DFL;
+        sigaction(SIGVTALRM, &action, NULL);
+    }
+    return result;
 }
 
-void memory_cleanup(void) {
-    if (kernel_state.memory_mgr.blocks) {
-        if (kernel_state.memory_mgr.blocks[0].base_addr) {
-            free(kernel_state.memory_mgr.blocks[0].base_addr);
+static void* scheduler_cpu_main(void* arg) {
+    scheduler_cpu_t* cpu = arg;
+    
+    this_cpu = cpu;
+    pthread_mutex_lock(&cpu_hosts_lock);
+    cpu_hosts[cpu->id].tid = (pid_t)syscall(SYS_gettid);
+    cpu_arm_timer(cpu->id);
+    pthread_mutex_unlock(&cpu_hosts_lock);
+    
+    scheduler_cpu_loop(cpu, 1);
+    
+    pthread_mutex_lock(&cpu_hosts_lock);
+    if (cpu_hosts[cpu->id].timer_armed) {
+        timer_delete(cpu_hosts[cpu->id].timer);
+        cpu_hosts[cpu->id].timer_armed = 0;
+    }
+    pthread_mutex_unlock(&cpu_hosts_lock);
+    return NULL;
+}
+
+// Bring CPUs 1 to count - 1 online, each on its own host thread. CPU 0 is
+// the thread that calls scheduler_run.
+int scheduler_start_cpus(uint32_t count) {
+    scheduler_t* sched = &kernel_state.scheduler;
+    if (count == 0 || count > SCHED_MAX_CPUS || workers_running) return -1;
+    
+    if (count > sched->cpu_count) {
+        sched->cpu_count = count;
+    }
+    __atomic_store_n(&sched->stopping, 0, __ATOMIC_RELEASE);
+    workers_running = 1;
+    for (uint32_t i = 1; i < count; i++) {
+        if (pthread_create(&cpu_hosts[i].thread, NULL, scheduler_cpu_main, &sched->cpus[i]) != 0) {
+            fprintf(stderr, "Scheduler: Failed to start CPU %u\n", i);
+            workers_running = i;
+            scheduler_stop_cpus();
+            return -1;
         }
-        free(kernel_state.memory_mgr.blocks);
-        kernel_state.memory_mgr.blocks = NULL;
+        workers_running = i + 1;
+    }
+    
+    printf("Scheduler: %u CPUs online\n", count);
+    return 0;
+}
+
+// Each CPU finishes with the process it is running (the timer preempts
+// processes that never yield), queues it and goes offline. Its queue is
+// left for the CPUs still running to steal from.
+void scheduler_stop_cpus(void) {
+    scheduler_t* sched = &kernel_state.scheduler;
+    if (!workers_running) return;
+    
+    __atomic_store_n(&sched->stopping, 1, __ATOMIC_RELEASE);
+    for (uint32_t i = 1; i < (uint32_t)workers_running; i++) {
+        pthread_mutex_lock(&sched->cpus[i].lock);
+        pthread_cond_signal(&sched->cpus[i].wake);
+        pthread_mutex_unlock(&sched->cpus[i].lock);
+        pthread_join(cpu_hosts[i].thread, NULL);
+    }
+    workers_running = 0;
+}
+
+// Counters are per CPU and read without their locks, so totals are a
+// snapshot while CPUs run
+void scheduler_get_stats(scheduler_stats_t* stats) {
+    scheduler_t* sched = &kernel_state.scheduler;
+    if (!stats) return;
+    
+    memset(stats, 0, sizeof(*stats));
+    stats->cpus = sched->cpu_count;
+    for (uint32_t i = 0; i < sched->cpu_count; i++) {
+        const scheduler_cpu_t* cpu = &sched->cpus[i];
+        stats->ticks += cpu->ticks;
+        stats->switches += cpu->switches;
+        stats->preemptions += cpu->preemptions;
+        stats->steals += cpu->steals;
     }
 }
 
-// Scheduler Implementation
 int scheduler_init(void) {
-    kernel_state.scheduler.current_process = NULL;
-    kernel_state.scheduler.process_list = NULL;
-    kernel_state.scheduler.next_pid = 1;
+    scheduler_t* sched = &kernel_state.scheduler;
+    
+    memset(sched, 0, sizeof(*sched));
+    sched->next_pid = 1;
+    sched->cpu_count = 1;
+    // Idle CPUs wait for timer deadlines on the monotonic clock
+    pthread_condattr_t wake_attr;
+    pthread_condattr_init(&wake_attr);
+    pthread_condattr_setclock(&wake_attr, CLOCK_MONOTONIC);
+    for (uint32_t i = 0; i < SCHED_MAX_CPUS; i++) {
+        sched->cpus[i].id = (int)i;
+        pthread_mutex_init(&sched->cpus[i].lock, NULL);
+        pthread_cond_init(&sched->cpus[i].wake, &wake_attr);
+    }
+    pthread_condattr_destroy(&wake_attr);
+    timer_wheel_init(&timer_wheel, timer_now_tick());
+    timer_next = TIMER_WHEEL_NONE;
+    for (uint32_t i = 0; i < FUTEX_BUCKETS; i++) {
+        wait_queue_init(&futex_buckets[i]);
+    }
+    
+    this_cpu = &sched->cpus[0];
+    memset(cpu_hosts, 0, sizeof(cpu_hosts));
+    cpu_hosts[0].thread = pthread_self();
+    cpu_hosts[0].tid = (pid_t)syscall(SYS_gettid);
+    sigemptyset(&timer_signals);
+    sigaddset(&timer_signals, SIGVTALRM);
+    
+    process_cache = kmem_cache_create("process_t", sizeof(process_t));
+    envelope_cache = kmem_cache_create("page_envelope", sizeof(page_envelope_t));
+    grant_cache = kmem_cache_create("page_grant", sizeof(page_grant_t));
+    next_grant = 1;
+    if (!process_cache || !envelope_cache || !grant_cache ||
+        pidmap_init(&sched->processes) != 0 || pidmap_init(&page_grants) != 0) {
+        return -1;
+    }
     
     printf("Scheduler: Initialized\n");
     return 0;
 }
 
+static void process_init_sched(process_t* process, int priority) {
+    process->priority = priority;
+    process->ticks_used = 0;
+    process->cpu = 0;
+    process->affinity = -1;
+    process->on_cpu = 0;
+    process->killed = 0;
+    process->context = NULL;
+    process->run_ns = 0;
+    process->wait_ns = 0;
+    process->ready_since_ns = 0;
+    process->last_run_ns = 0;
+    process->voluntary_switches = 0;
+    process->involuntary_switches = 0;
+    wheel_timer_init(&process->sleep_timer, process_sleep_expired, (void*)(uintptr_t)process->pid);
+    process->wait_queue = NULL;
+    process->wait_prev = NULL;
+    process->wait_next = NULL;
+    process->futex_addr = 0;
+    process->mailbox_head = NULL;
+    process->mailbox_tail = NULL;
+    wait_queue_init(&process->mailbox);
+    process->transfer_map = NULL;
+    process->transfer_next = 0;
+}
+
+// Enter a new process in the table and queue it on its CPU
+static int process_publish(process_t* process) {
+    process_table_write();
+    int result = pidmap_insert(&kernel_state.scheduler.processes, process->pid, process);
+    process_table_unlock();
+    if (result != 0) return -1;
+    
+    scheduler_cpu_t* cpu = &kernel_state.scheduler.cpus[process->cpu];
+    cpu_lock(cpu);
+    process_make_ready(cpu, process);
+    cpu_unlock(cpu);
+    return 0;
+}
+
+// Only the allocations take the kernel lock; the process table has its own
+static void process_discard(process_t* process) {
+    kernel_enter();
+    paging_destroy_space(process->address_space);
+    kmem_cache_free(process_cache, process);
+    kernel_leave();
+}
+
 uint32_t process_create(const char* name, void* entry_point, size_t memory_size) {
-    process_t* process = malloc(sizeof(process_t));
-    if (!process) return 0;
+    kernel_enter();
+    process_t* process = kmem_cache_alloc(process_cache);
+    if (!process) {
+        kernel_leave();
+        return 0;
+    }
     
-    process->pid = kernel_state.scheduler.next_pid++;
+    // Process memory is demand-zero: frames are only taken on first touch
+    process->address_space = paging_create_space();
+    if (!process->address_space) {
+        kmem_cache_free(process_cache, process);
+        kernel_leave();
+        return 0;
+    }
+    if (memory_size > UINT32_MAX - PROCESS_MEMORY_BASE ||
+        paging_reserve(process->address_space, PROCESS_MEMORY_BASE, memory_size, 1) != 0) {
+        paging_destroy_space(process->address_space);
+        kmem_cache_free(process_cache, process);
+        kernel_leave();
+        return 0;
+    }
+    kernel_leave();
+    
+    // Once published the process may be gone again, so keep its PID here
+    uint32_t pid = __atomic_fetch_add(&kernel_state.scheduler.next_pid, 1, __ATOMIC_RELAXED);
+    process->pid = pid;
     strncpy(process->name, name, sizeof(process->name) - 1);
     process->name[sizeof(process->name) - 1] = '\0';
+    process->memory_size = memory_size;
+    process->memory_used = 0;
+    process_init_sched(process, 0);
+    if (process_publish(process) != 0) {
+        process_discard(process);
+        return 0;
+    }
     
-    process->memory_base = memory_alloc(memory_size);
-    if (!process->memory_base) {
-        free(process);
+    printf("Process: Created '%s' (PID: %u)\n", name, pid);
+    return pid;
+}
+
+// Fork-like clone: the child shares every page of the parent copy-on-write
+uint32_t process_clone(uint32_t pid) {
+    kernel_enter();
+    process_t* parent = process_find(pid);
+    process_t* process = parent ? kmem_cache_alloc(process_cache) : NULL;
+    if (!process) {
+        kernel_leave();
         return 0;
     }
     
-    process->memory_size = memory_size;
-    process->state = 0; // Ready
+    // Received pages stay with the parent; the child starts with an empty
+    // transfer window and no grants
+    process->address_space = paging_clone_space(parent->address_space, PROCESS_TRANSFER_BASE);
+    if (!process->address_space) {
+        kmem_cache_free(process_cache, process);
+        kernel_leave();
+        return 0;
+    }
+    
+    uint32_t child = __atomic_fetch_add(&kernel_state.scheduler.next_pid, 1, __ATOMIC_RELAXED);
+    char name[sizeof(process->name)];
+    memcpy(name, parent->name, sizeof(name));
+    process->pid = child;
+    memcpy(process->name, name, sizeof(process->name));
+    process->memory_size = parent->memory_size;
+    process->memory_used = parent->memory_used;
+    process_init_sched(process, parent->priority); // Host stacks are not copied; the child is started on its own
+    process->cpu = parent->cpu;
+    process->affinity = parent->affinity;
+    kernel_leave();
     
-    // Add to process list
-    process->next = kernel_state.scheduler.process_list;
-    kernel_state.scheduler.process_list = process;
+    if (process_publish(process) != 0) {
+        process_discard(process);
+        return 0;
+    }
     
-    printf("Process: Created '%s' (PID: %u)\n", name, process->pid);
-    return process->pid;
+    printf("Process: Cloned '%s' (PID: %u -> %u)\n", name, pid, child);
+    return child;
 }
 
+// Voluntary yield; the quantum already used at this level still counts.
+// From process context this returns to the CPU's loop, which picks.
 void process_switch(void) {
-    // Simple round-robin scheduling
-    if (kernel_state.scheduler.current_process && kernel_state.scheduler.current_process->next) {
-        kernel_state.scheduler.current_process = kernel_state.scheduler.current_process->next;
-    } else {
-        kernel_state.scheduler.current_process = kernel_state.scheduler.process_list;
+    process_context_t* context = context_self();
+    if (context) {
+        context_yield(context, 0);
+        return;
+    }
+    
+    scheduler_pick(cpu_self());
+    
+    // Same-page merging runs a batch in the background every so many
+    // switches, counted across all CPUs
+    if (__atomic_add_fetch(&merge_switches, 1, __ATOMIC_RELAXED) % PAGING_MERGE_INTERVAL == 0 &&
+        kernel_try_enter()) {
+        paging_merge_scan(PAGING_MERGE_BATCH);
+        kernel_leave();
     }
 }
 
-void process_terminate(uint32_t pid) {
-    process_t* prev = NULL;
-    process_t* current = kernel_state.scheduler.process_list;
-    
-    while (current) {
-        if (current->pid == pid) {
-            if (prev) {
-                prev->next = current->next;
-            } else {
-                kernel_state.scheduler.process_list = current->next;
+// Timer tick: charge the running process, demote it once its quantum at
+// this level is spent, and preempt it for anything at a higher level
+void scheduler_tick(void) {
+    scheduler_cpu_t* cpu = cpu_self();
+    int resched = 1;
+    
+    cpu_lock(cpu);
+    if (++cpu->ticks % SCHED_BOOST_TICKS == 0) {
+        scheduler_boost(cpu);
+    }
+    
+    process_t* current = cpu->current_process;
+    if (current) {
+        if (++current->ticks_used >= (uint32_t)SCHED_QUANTUM_TICKS << current->priority) {
+            current->ticks_used = 0;
+            if (current->priority < SCHED_LEVELS - 1) {
+                current->priority++;
+            }
+        } else if (!(cpu->run_bitmap & ((1u << current->priority) - 1))) {
+            resched = 0;
+        }
+    }
+    cpu_unlock(cpu);
+    
+    if (resched) {
+        process_switch();
+    }
+}
+
+// Blocked processes leave the run queue until woken
+int process_block(uint32_t pid) {
+    process_table_read();
+    process_t* process = process_lookup(pid);
+    int result = process ? process_set_blocked(process) : -1;
+    process_table_unlock();
+    
+    if (result > 0) {
+        process_switch(); // Returns once woken when called from process context
+    }
+    return result < 0 ? -1 : 0;
+}
+
+// A process that blocked again before using a single tick at its level is
+// interactive and moves up. Ticks already used keep counting, so sleeping
+// just before the quantum runs out does not dodge demotion.
+int process_wake(uint32_t pid) {
+    int result = -1;
+    int kick = 0;
+    
+    process_table_read();
+    process_t* process = process_lookup(pid);
+    if (process) {
+        scheduler_cpu_t* target = scheduler_place(process);
+        scheduler_cpu_t* cpu = process_lock_with(process, target);
+        if (process->state == PROCESS_BLOCKED) {
+            if (process->ticks_used == 0 && process->priority > 0) {
+                process->priority--;
             }
-            
-            if (kernel_state.scheduler.current_process == current) {
-                kernel_state.scheduler.current_process = current->next;
+            if (process->context) {
+                __atomic_fetch_add(&kernel_state.scheduler.active, 1, __ATOMIC_RELAXED);
             }
-            
-            memory_free(current->memory_base);
-            free(current);
-            printf("Process: Terminated PID %u\n", pid);
-            return;
+            process_make_ready(target, process);
+            kick = target->current_process != NULL;
+            result = 0;
+        }
+        cpu_unlock_pair(cpu, target);
+    }
+    process_table_unlock();
+    
+    if (kick) {
+        scheduler_kick();
+    }
+    return result;
+}
+
+void process_terminate(uint32_t pid) {
+    // A process cannot free the stack it runs on; its CPU's loop does it
+    process_t* self = process_get_current();
+    if (context_self() && self && self->pid == pid) {
+        process_exit();
+        return;
+    }
+    
+    kernel_enter();
+    process_t* process = process_find(pid);
+    if (process) {
+        scheduler_cpu_t* cpu = process_lock(process);
+        int running = __atomic_load_n(&process->on_cpu, __ATOMIC_ACQUIRE);
+        if (running) {
+            process->killed = 1;
+        } else {
+            process_detach(cpu, process);
+        }
+        cpu_unlock(cpu);
+        
+        if (!running) {
+            process_destroy(process);
         }
-        prev = current;
-        current = current->next;
     }
+    kernel_leave();
+    scheduler_kick_main();
 }
 
 process_t* process_get_current(void) {
-    return kernel_state.scheduler.current_process;
+    return cpu_self()->current_process;
+}
+
+// The process stays valid only while the caller holds the kernel lock,
+// which destroying one takes
+process_t* process_find(uint32_t pid) {
+    process_table_read();
+    process_t* process = process_lookup(pid);
+    process_table_unlock();
+    return process;
+}
+
+// Caller holds the process table lock
+static void process_fill_stat(process_t* process, process_stat_t* stat) {
+    scheduler_cpu_t* cpu = process_lock(process);
+    
+    stat->pid = process->pid;
+    strncpy(stat->name, process->name, sizeof(stat->name) - 1);
+    stat->name[sizeof(stat->name) - 1] = '\0';
+    stat->state = process->state;
+    stat->priority = process->priority;
+    stat->cpu = process->cpu;
+    stat->run_ns = process->run_ns;
+    stat->wait_ns = process->wait_ns;
+    stat->last_run_ns = process->last_run_ns;
+    stat->voluntary_switches = process->voluntary_switches;
+    stat->involuntary_switches = process->involuntary_switches;
+    
+    uint64_t now = scheduler_now_ns();
+    if (__atomic_load_n(&process->on_cpu, __ATOMIC_RELAXED) && process->last_run_ns) {
+        stat->run_ns += now - process->last_run_ns;
+    } else if (process->ready_since_ns) {
+        stat->wait_ns += now - process->ready_since_ns;
+    }
+    cpu_unlock(cpu);
+}
+
+int process_get_stat(uint32_t pid, process_stat_t* stat) {
+    if (!stat) return -1;
+    
+    process_table_read();
+    process_t* process = process_lookup(pid);
+    if (process) {
+        process_fill_stat(process, stat);
+    }
+    process_table_unlock();
+    return process ? 0 : -1;
+}
+
+// Fills up to max entries in PID table order and returns how many were
+// filled; with max 0 it only counts
+size_t process_list_stats(process_stat_t* stats, size_t max) {
+    size_t count = 0;
+    size_t cursor = 0;
+    
+    process_table_read();
+    if (!stats || max == 0) {
+        count = kernel_state.scheduler.processes.count;
+    } else {
+        process_t* process;
+        while (count < max && (process = pidmap_next(&kernel_state.scheduler.processes, &cursor, NULL))) {
+            process_fill_stat(process, &stats[count++]);
+        }
+    }
+    process_table_unlock();
+    return count;
+}
+
+// Bump allocation inside the process's own address space. Everything handed
+// out here is released at once when the space is destroyed or reset.
+vaddr_t process_memory_alloc(process_t* process, size_t size) {
+    if (!process || !process->address_space || size == 0) return 0;
+    
+    size_t offset = (process->memory_used + PROCESS_MEMORY_ALIGN - 1) & ~(size_t)(PROCESS_MEMORY_ALIGN - 1);
+    if (offset > process->memory_size || size > process->memory_size - offset) {
+        return 0;
+    }
+    
+    process->memory_used = offset + size;
+    return (vaddr_t)(PROCESS_MEMORY_BASE + offset);
+}
+
+void process_memory_reset(process_t* process) {
+    if (process) {
+        process->memory_used = 0;
+    }
 }
 
 // Device Management Implementation
@@ -215,8 +2449,21 @@ int device_init(mindose_config_t* config) {
     
     printf("Devices: Initializing virtual devices...\n");
     
+    kernel_state.device_mgr.disk.fd = -1;
     if (kernel_state.device_mgr.diskimage_path) {
         printf("Devices: Disk image: %s\n", kernel_state.device_mgr.diskimage_path);
+        if (block_open(&kernel_state.device_mgr.disk, kernel_state.device_mgr.diskimage_path) != 0) {
+            fprintf(stderr, "Devices: Cannot map disk image %s, no block device\n",
+                    kernel_state.device_mgr.diskimage_path);
+        } else if (config->bcache_percent != BCACHE_DISABLED) {
+            // The cache share is taken from the arena, so keep it well under --mem
+            int percent = config->bcache_percent > 0 ? config->bcache_percent : BCACHE_DEFAULT_PERCENT;
+            if (percent > BCACHE_MAX_PERCENT) percent = BCACHE_MAX_PERCENT;
+            size_t bytes = parse_memory_size(config->mem_size) / 100 * (size_t)percent;
+            if (bcache_init(&kernel_state.device_mgr.cache, &kernel_state.device_mgr.disk, bytes) != 0) {
+                fprintf(stderr, "Devices: Failed to set up the buffer cache\n");
+            }
+        }
     }
     
     if (kernel_state.device_mgr.iso_path) {
@@ -228,6 +2475,10 @@ int device_init(mindose_config_t* config) {
 }
 
 void device_cleanup(void) {
+    // Writes back whatever is still dirty, the cache first
+    bcache_destroy(&kernel_state.device_mgr.cache);
+    block_close(&kernel_state.device_mgr.disk);
+    
     if (kernel_state.device_mgr.mem_size) {
         free(kernel_state.device_mgr.mem_size);
         kernel_state.device_mgr.mem_size = NULL;
@@ -246,18 +2497,12 @@ void device_cleanup(void) {
     kernel_state.device_mgr.devices_initialized = 0;
 }
 
-// System Call Handler
-int syscall_handler(int call_num, void* args) {
-    switch (call_num) {
-        case 1: // Memory allocation
-            return (int)(intptr_t)memory_alloc(*(size_t*)args);
-        case 2: // Memory free
-            memory_free(args);
-            return 0;
-        case 3: // Process create
-            // TODO: Implement process creation syscall
-            return 0;
-        default:
-            return -1; // Unknown system call
-    }
+// The block device a file system mounts on, NULL without a disk image
+block_device_t* device_get_disk(void) {
+    return kernel_state.device_mgr.disk.base ? &kernel_state.device_mgr.disk : NULL;
+}
+
+// Cached access to the same device; metadata reads should go through here
+buffer_cache_t* device_get_cache(void) {
+    return kernel_state.device_mgr.cache.buffers ? &kernel_state.device_mgr.cache : NULL;
 }
@@ -3,35 +3,224 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <pthread.h>
 #include "../common.h"
+#include "paging.h"
+#include "pidmap.h"
+#include "timerwheel.h"
+#include "syscalls.h"
+#include "block.h"
+#include "bcache.h"
 
 // Memory management
+#define MEMORY_PAGE_SHIFT 12
+#define MEMORY_PAGE_SIZE  ((size_t)1 << MEMORY_PAGE_SHIFT)
+#define MEMORY_MAX_ORDER  32
+#define MEMORY_PAGE_NONE  UINT32_MAX
+
+#define MEMORY_HUGE_PAGE_SIZE ((size_t)2 << 20)
+#define MEMORY_RELEASE_PAGES  16 // Free runs at least this long go back to the host
+
+// Page flags
+#define MEMORY_PAGE_HEAD 0x01 // First page of a run (header tag)
+#define MEMORY_PAGE_TAIL 0x02 // Last page of a run (footer tag)
+#define MEMORY_PAGE_FREE 0x04 // Run is on a free list
+#define MEMORY_PAGE_DIRTY 0x08 // Free run may still hold committed host pages
+#define MEMORY_PAGE_SLAB 0x10 // One-page run owned by the slab allocator
+
+// Per-page boundary tags, kept outside the arena. The first and last page
+// of every run record its length, so a freed run can find and absorb its
+// free neighbours in constant time. Free list links live on the head page.
 typedef struct {
-    void* base_addr;
-    size_t size;
-    int is_allocated;
-} memory_block_t;
+    uint32_t run;   // Pages in the run (head and tail pages only)
+    uint32_t prev;
+    uint32_t next;
+    uint8_t order;  // Free list index: floor(log2(run))
+    uint8_t flags;
+} memory_page_t;
 
+// Segregated free lists of page runs over the simulated RAM arena
 typedef struct {
-    memory_block_t* blocks;
-    size_t block_count;
+    uint8_t* arena;
+    memory_page_t* pages;
+    uint32_t page_count;
+    uint32_t free_lists[MEMORY_MAX_ORDER];
+    uint32_t free_bitmap; // Bit n set when free_lists[n] is non-empty
+    size_t free_pages;
+    size_t free_runs;
+    size_t dirty_pages;   // Free pages not yet returned to the host
     size_t total_memory;
+    int huge_pages;       // Back large runs with transparent huge pages
+    int tracing;          // Record allocations with memtrace
+    int trace_depth;      // Allocator calls in progress; only the outermost is traced
 } memory_manager_t;
 
+// Allocator statistics
+typedef struct {
+    size_t total_bytes;
+    size_t free_bytes;
+    size_t free_runs;
+    size_t largest_free_bytes;
+    size_t dirty_free_bytes;
+    double fragmentation; // 1 - largest free run / total free, 0 when unfragmented
+} memory_stats_t;
+
 // Process management
+#define PROCESS_MEMORY_ALIGN 16
+#define PROCESS_MEMORY_BASE  0x00400000 // Start of the process image in its address space
+
+#define PROCESS_READY      0
+#define PROCESS_RUNNING    1
+#define PROCESS_BLOCKED    2
+#define PROCESS_TERMINATED 3
+
+// Multi-level feedback queue: level 0 runs first and has the shortest
+// quantum, each level below doubles it
+#define SCHED_LEVELS        8
+#define SCHED_QUANTUM_TICKS 2   // Quantum at level 0
+#define SCHED_BOOST_TICKS   200 // Everyone returns to level 0 this often
+#define SCHED_MAX_CPUS      64
+
+// Kernel timers run on a wheel of 1 ms ticks
+#define KERNEL_TIMER_TICK_NS 1000000ull
+
+// Host execution contexts: each started process runs on its own stack
+#define PROCESS_STACK_SIZE ((size_t)64 << 10) // Lowest page is a guard page
+
+typedef void (*process_entry_t)(void* arg);
+typedef struct process_context process_context_t;
+
+// Processes blocked until woken, in FIFO order, under the queue's own lock
+typedef struct wait_queue {
+    pthread_mutex_t lock;
+    struct process* head;
+    struct process* tail;
+    size_t count;
+} wait_queue_t;
+
+// Futex waiters hash on their address space and simulated address
+#define FUTEX_BUCKETS 256 // Power of two
+
+// Syscall 12 waits while the 32-bit word at addr still holds value, for at
+// most timeout_ms (0 waits forever); syscall 13 wakes up to value waiters
+typedef struct {
+    vaddr_t addr;
+    uint32_t value;
+    uint32_t timeout_ms;
+} futex_request_t;
+
+// Page messages pass whole pages between address spaces by remapping them.
+// A move takes the pages from the sender; a grant shares them read-only
+// until the sender revokes it or either side exits. Received pages are
+// mapped into the receiver's transfer window, above its own memory.
+#define PROCESS_TRANSFER_BASE 0x80000000u
+#define PROCESS_TRANSFER_SIZE 0x40000000u
+
+#define PAGE_SEND_MOVE  0
+#define PAGE_SEND_GRANT 1
+
+// Syscall 16 sends size bytes at the page-aligned addr to pid, returning the
+// grant handle (0 for a move); syscall 17 waits for the next message
+typedef struct {
+    uint32_t pid;
+    vaddr_t addr;
+    uint32_t size;
+    uint32_t flags; // PAGE_SEND_MOVE or PAGE_SEND_GRANT
+} page_send_request_t;
+
+typedef struct {
+    uint32_t sender;
+    uint32_t grant; // Handle for process_page_revoke, 0 for moves
+    vaddr_t addr;   // Where the pages are mapped in the receiver
+    uint32_t size;
+} page_message_t;
+
 typedef struct process {
     uint32_t pid;
     char name[256];
-    void* memory_base;
+    address_space_t* address_space;
     size_t memory_size;
-    int state; // 0=ready, 1=running, 2=blocked, 3=terminated
-    struct process* next;
+    size_t memory_used; // Bump offset for process_memory_alloc
+    int state; // PROCESS_READY, _RUNNING, _BLOCKED or _TERMINATED
+    int priority;        // Current MLFQ level
+    uint32_t ticks_used; // Ticks charged at this level, yields included
+    int cpu;             // CPU whose run queue holds the process, or that last ran it
+    int affinity;        // Preferred CPU, -1 for none
+    int on_cpu;          // Set until its CPU has switched away from it
+    int killed;          // Terminate once its CPU switches away
+    struct process* run_prev; // Run queue links, only while ready
+    struct process* run_next;
+    process_context_t* context; // Stack and saved registers, NULL until started
+    uint64_t run_ns;            // Time on a CPU; accounting covers started processes
+    uint64_t wait_ns;           // Time ready while others ran
+    uint64_t ready_since_ns;    // When it last became ready, 0 while not ready
+    uint64_t last_run_ns;       // When a CPU last switched to it, 0 if never
+    uint64_t voluntary_switches;   // Yields, blocks and exits
+    uint64_t involuntary_switches; // Timer preemptions
+    wheel_timer_t sleep_timer;     // Wakes the process from process_sleep and wait timeouts
+    wait_queue_t* wait_queue;      // Queue the process is blocked on, NULL once woken
+    struct process* wait_prev;
+    struct process* wait_next;
+    vaddr_t futex_addr;            // Futex key within its address space while queued on one
+    struct page_envelope* mailbox_head; // Page messages not yet received
+    struct page_envelope* mailbox_tail;
+    wait_queue_t mailbox;               // Receivers waiting for a page message
+    uint64_t* transfer_map;             // Transfer window pages in use, allocated on first receipt
+    size_t transfer_next;               // Window page the next search starts from
 } process_t;
 
+// Accounting snapshot of one process; times are CLOCK_MONOTONIC nanoseconds
 typedef struct {
+    uint32_t pid;
+    char name[64];
+    int state;
+    int priority;
+    int cpu;
+    uint64_t run_ns; // Includes the current run of a running process
+    uint64_t wait_ns;
+    uint64_t last_run_ns;
+    uint64_t voluntary_switches;
+    uint64_t involuntary_switches;
+} process_stat_t;
+
+// One simulated CPU: a host thread with its own MLFQ run queues. Only the
+// CPU's lock guards them; idle CPUs steal from busy ones.
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake; // Signalled when work is queued on an idle CPU
     process_t* current_process;
-    process_t* process_list;
+    process_t* run_head[SCHED_LEVELS];
+    process_t* run_tail[SCHED_LEVELS];
+    uint32_t run_bitmap; // Bit n set while level n has a ready process
+    uint32_t ready;      // Processes in the run queues
+    uint32_t runnable;   // Started processes among them
+    int id;
+    int online;          // A host thread is running this CPU's loop
+    int idle;
+    uint64_t ticks;
+    uint64_t switches;    // Entries into process context
+    uint64_t preemptions; // Timer ticks that took the CPU from a process
+    uint64_t steals;      // Processes taken from other CPUs
+} __attribute__((aligned(64))) scheduler_cpu_t;
+
+// Totals over all CPUs
+typedef struct {
+    uint32_t cpus;
+    uint64_t ticks;
+    uint64_t switches;
+    uint64_t preemptions;
+    uint64_t steals;
+} scheduler_stats_t;
+
+typedef struct {
+    scheduler_cpu_t cpus[SCHED_MAX_CPUS]; // CPU 0 is the thread that called scheduler_init
+    uint32_t cpu_count;
+    pidmap_t processes;      // PID -> process_t, under the process table lock
     uint32_t next_pid;
+    uint32_t context_count;  // Processes with an execution context
+    uint32_t active;         // Started processes that are ready or running
+    uint32_t kick_seq;       // Bumped whenever an idle CPU may find work elsewhere
+    int stopping;
 } scheduler_t;
 
 // Device management
@@ -39,6 +228,8 @@ typedef struct {
     char* mem_size;
     char* diskimage_path;
     char* iso_path;
+    block_device_t disk; // The disk image, fd -1 without one
+    buffer_cache_t cache; // Over disk, empty without it
     int devices_initialized;
 } device_manager_t;
 
@@ -57,21 +248,58 @@ void kernel_cleanup(void);
 // Memory management functions
 int memory_init(size_t total_size);
 void* memory_alloc(size_t size);
+void* memory_alloc_aligned(size_t size, size_t align);
 void memory_free(void* ptr);
 void memory_cleanup(void);
+void memory_get_stats(memory_stats_t* stats);
+uint32_t memory_page_count(void);
+uint32_t memory_page_index(const void* ptr);
+void* memory_page_address(uint32_t index);
+void memory_mark_slab(void* page, int slab);
 
 // Process management functions
 int scheduler_init(void);
 uint32_t process_create(const char* name, void* entry_point, size_t memory_size);
+uint32_t process_clone(uint32_t pid);
 void process_switch(void);
+void scheduler_tick(void);
+int process_block(uint32_t pid);
+int process_wake(uint32_t pid);
 void process_terminate(uint32_t pid);
+int process_start(uint32_t pid, process_entry_t entry, void* arg);
+void process_exit(void);
+int process_sleep(unsigned ms);
+void kernel_timer_start(wheel_timer_t* timer, uint64_t delay_ms);
+int kernel_timer_cancel(wheel_timer_t* timer);
+void wait_queue_init(wait_queue_t* queue);
+int wait_queue_wait(wait_queue_t* queue, unsigned timeout_ms);
+size_t wait_queue_wake(wait_queue_t* queue, size_t count);
+int futex_wait(vaddr_t addr, uint32_t value, unsigned timeout_ms);
+int futex_wake(vaddr_t addr, size_t count);
+int64_t process_page_send(uint32_t pid, vaddr_t addr, size_t size, int flags);
+int process_page_receive(page_message_t* message, unsigned timeout_ms);
+int process_page_revoke(uint32_t grant);
+int process_page_release(vaddr_t addr, size_t size);
+void kernel_enter(void);
+void kernel_leave(void);
+int process_set_affinity(uint32_t pid, int cpu);
+size_t scheduler_run(void);
+int scheduler_set_timer(unsigned interval_us);
+int scheduler_start_cpus(uint32_t count);
+void scheduler_stop_cpus(void);
+void scheduler_get_stats(scheduler_stats_t* stats);
 process_t* process_get_current(void);
+process_t* process_find(uint32_t pid);
+int process_get_stat(uint32_t pid, process_stat_t* stat);
+size_t process_list_stats(process_stat_t* stats, size_t max);
+uint64_t scheduler_now_ns(void);
+vaddr_t process_memory_alloc(process_t* process, size_t size);
+void process_memory_reset(process_t* process);
 
 // Device management functions
 int device_init(mindose_config_t* config);
 void device_cleanup(void);
-
-// System calls
-int syscall_handler(int call_num, void* args);
+block_device_t* device_get_disk(void);
+buffer_cache_t* device_get_cache(void);
 
 #endif // KERNEL_H
@@ -0,0 +1,260 @@
+#include "memtrace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Events go to a ring any producer can claim slots in with one atomic add.
+// Live blocks are tracked in an open-addressed table keyed by address; both
+// live on the host heap so tracing never allocates from the arena it watches.
+static memtrace_event_t* ring = NULL;
+static uint64_t ring_head = 0;
+static uint64_t ring_tail = 0;
+static uint64_t ring_dropped = 0;
+
+static memtrace_block_t* blocks = NULL;
+static size_t block_capacity = 0;
+static size_t block_count = 0;
+
+static size_t memtrace_hash(const void* ptr) {
+    uint64_t key = (uint64_t)(uintptr_t)ptr;
+    return (size_t)((key >> 4) * 0x9E3779B97F4A7C15ull >> 17);
+}
+
+static void memtrace_record(uint32_t type, void* ptr, size_t size, void* site, uint32_t pid) {
+    uint64_t seq = __atomic_fetch_add(&ring_head, 1, __ATOMIC_RELAXED);
+    memtrace_event_t* event = &ring[seq & (MEMTRACE_RING_EVENTS - 1)];
+    
+    // Mark the entry busy, fill it in, then publish it
+    __atomic_store_n(&event->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    event->ptr = ptr;
+    event->site = site;
+    event->size = size;
+    event->pid = pid;
+    event->type = type;
+    __atomic_store_n(&event->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+static int memtrace_grow(void) {
+    size_t capacity = block_capacity ? block_capacity * 2 : 4096;
+    memtrace_block_t* table = calloc(capacity, sizeof(memtrace_block_t));
+    if (!table) return -1;
+    
+    for (size_t i = 0; i < block_capacity; i++) {
+        if (!blocks[i].ptr) continue;
+        size_t slot = memtrace_hash(blocks[i].ptr) & (capacity - 1);
+        while (table[slot].ptr) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        table[slot] = blocks[i];
+    }
+    
+    free(blocks);
+    blocks = table;
+    block_capacity = capacity;
+    return 0;
+}
+
+int memtrace_init(void) {
+    ring = calloc(MEMTRACE_RING_EVENTS, sizeof(memtrace_event_t));
+    if (!ring) return -1;
+    
+    ring_head = 0;
+    ring_tail = 0;
+    ring_dropped = 0;
+    block_count = 0;
+    if (memtrace_grow() != 0) {
+        free(ring);
+        ring = NULL;
+        return -1;
+    }
+    
+    printf("Memtrace: Tracing allocations, %d event ring\n", MEMTRACE_RING_EVENTS);
+    return 0;
+}
+
+void memtrace_cleanup(void) {
+    if (ring) {
+        free(ring);
+        ring = NULL;
+    }
+    if (blocks) {
+        free(blocks);
+        blocks = NULL;
+    }
+    block_capacity = 0;
+    block_count = 0;
+}
+
+void memtrace_alloc(void* ptr, size_t size, void* site, uint32_t pid) {
+    if (!ring) return;
+    
+    memtrace_record(MEMTRACE_ALLOC, ptr, size, site, pid);
+    
+    // Keep the table at most half full
+    if ((block_count + 1) * 2 > block_capacity && memtrace_grow() != 0) {
+        return;
+    }
+    
+    size_t slot = memtrace_hash(ptr) & (block_capacity - 1);
+    while (blocks[slot].ptr) {
+        slot = (slot + 1) & (block_capacity - 1);
+    }
+    blocks[slot].ptr = ptr;
+    blocks[slot].site = site;
+    blocks[slot].size = size;
+    blocks[slot].pid = pid;
+    blocks[slot].leaked = 0;
+    block_count++;
+}
+
+void memtrace_free(void* ptr) {
+    if (!ring) return;
+    
+    size_t mask = block_capacity - 1;
+    size_t slot = memtrace_hash(ptr) & mask;
+    while (blocks[slot].ptr && blocks[slot].ptr != ptr) {
+        slot = (slot + 1) & mask;
+    }
+    if (!blocks[slot].ptr) return; // Allocated inside the allocator itself, or before tracing
+    
+    memtrace_record(MEMTRACE_FREE, ptr, blocks[slot].size, blocks[slot].site, blocks[slot].pid);
+    
+    // Backward-shift deletion keeps probe chains intact without tombstones
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask; blocks[next].ptr; next = (next + 1) & mask) {
+        size_t home = memtrace_hash(blocks[next].ptr) & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            blocks[hole] = blocks[next];
+            hole = next;
+        }
+    }
+    blocks[hole].ptr = NULL;
+    block_count--;
+}
+
+// Copy out events not read yet. Entries the producers lapped are counted
+// as dropped; an entry being rewritten during the copy is dropped as well.
+size_t memtrace_read(memtrace_event_t* events, size_t max) {
+    size_t count = 0;
+    if (!ring || !events) return 0;
+    
+    uint64_t head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+    if (head - ring_tail > MEMTRACE_RING_EVENTS) {
+        ring_dropped += head - MEMTRACE_RING_EVENTS - ring_tail;
+        ring_tail = head - MEMTRACE_RING_EVENTS;
+    }
+    
+    while (count < max && ring_tail < head) {
+        memtrace_event_t* event = &ring[ring_tail & (MEMTRACE_RING_EVENTS - 1)];
+        uint64_t seq = __atomic_load_n(&event->seq, __ATOMIC_ACQUIRE);
+        if (seq == 0 || seq < ring_tail + 1) break; // Still being written
+        
+        events[count] = *event;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (seq != ring_tail + 1 || __atomic_load_n(&event->seq, __ATOMIC_RELAXED) != seq) {
+            ring_dropped++;
+        } else {
+            count++;
+        }
+        ring_tail++;
+    }
+    
+    return count;
+}
+
+static int compare_owners(const void* a, const void* b) {
+    size_t x = ((const memtrace_owner_t*)a)->live_bytes;
+    size_t y = ((const memtrace_owner_t*)b)->live_bytes;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static int compare_sites(const void* a, const void* b) {
+    size_t x = ((const memtrace_site_t*)a)->live_bytes;
+    size_t y = ((const memtrace_site_t*)b)->live_bytes;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+int memtrace_snapshot(memtrace_snapshot_t* snapshot) {
+    if (!snapshot) return -1;
+    memset(snapshot, 0, sizeof(*snapshot));
+    if (!ring) return -1;
+    
+    // Distinct owners and sites are few, a linear scan per block is enough
+    memtrace_owner_t* owners = calloc(block_count + 1, sizeof(memtrace_owner_t));
+    memtrace_site_t* sites = calloc(block_count + 1, sizeof(memtrace_site_t));
+    if (!owners || !sites) {
+        free(owners);
+        free(sites);
+        return -1;
+    }
+    size_t owner_count = 0;
+    size_t site_count = 0;
+    
+    for (size_t i = 0; i < block_capacity; i++) {
+        const memtrace_block_t* block = &blocks[i];
+        if (!block->ptr) continue;
+        
+        snapshot->live_bytes += block->size;
+        snapshot->live_blocks++;
+        if (block->leaked) {
+            snapshot->leaked_bytes += block->size;
+            snapshot->leaked_blocks++;
+        }
+        
+        size_t o = 0;
+        while (o < owner_count && owners[o].pid != block->pid) o++;
+        if (o == owner_count) {
+            owners[owner_count++].pid = block->pid;
+        }
+        owners[o].live_bytes += block->size;
+        owners[o].live_blocks++;
+        
+        size_t s = 0;
+        while (s < site_count && sites[s].site != block->site) s++;
+        if (s == site_count) {
+            sites[site_count++].site = block->site;
+        }
+        sites[s].live_bytes += block->size;
+        sites[s].live_blocks++;
+    }
+    
+    qsort(owners, owner_count, sizeof(memtrace_owner_t), compare_owners);
+    qsort(sites, site_count, sizeof(memtrace_site_t), compare_sites);
+    snapshot->owner_count = owner_count < MEMTRACE_TOP ? owner_count : MEMTRACE_TOP;
+    snapshot->site_count = site_count < MEMTRACE_TOP ? site_count : MEMTRACE_TOP;
+    memcpy(snapshot->owners, owners, snapshot->owner_count * sizeof(memtrace_owner_t));
+    memcpy(snapshot->sites, sites, snapshot->site_count * sizeof(memtrace_site_t));
+    
+    snapshot->events = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+    snapshot->dropped = ring_dropped;
+    
+    free(owners);
+    free(sites);
+    return 0;
+}
+
+// Flag every block a terminated process still owns
+size_t memtrace_check_leaks(uint32_t pid) {
+    size_t leaked = 0;
+    size_t bytes = 0;
+    if (!ring) return 0;
+    
+    for (size_t i = 0; i < block_capacity; i++) {
+        memtrace_block_t* block = &blocks[i];
+        if (!block->ptr || block->pid != pid || block->leaked) continue;
+        
+        block->leaked = 1;
+        leaked++;
+        bytes += block->size;
+        if (leaked <= MEMTRACE_TOP) {
+            printf("Memtrace: PID %u leaked %zu bytes at %p (allocated from %p)\n",
+                   pid, block->size, block->ptr, block->site);
+        }
+    }
+    
+    if (leaked) {
+        printf("Memtrace: PID %u leaked %zu bytes in %zu blocks\n", pid, bytes, leaked);
+    }
+    return leaked;
+}
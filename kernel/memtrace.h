@@ -0,0 +1,70 @@
+#ifndef MEMTRACE_H
+#define MEMTRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Opt-in allocation tracing for memory_alloc/memory_free
+#define MEMTRACE_RING_EVENTS 65536 // Power of two
+#define MEMTRACE_TOP         16    // Owners and call-sites kept in a snapshot
+#define MEMTRACE_ALLOC       1
+#define MEMTRACE_FREE        2
+
+// One ring entry; seq is the event number plus one once the entry is complete
+typedef struct {
+    uint64_t seq;
+    void* ptr;
+    void* site;
+    size_t size;
+    uint32_t pid;
+    uint32_t type;
+} memtrace_event_t;
+
+// A live block
+typedef struct {
+    void* ptr;
+    void* site;
+    size_t size;
+    uint32_t pid;
+    uint32_t leaked; // Still live after its process terminated
+} memtrace_block_t;
+
+typedef struct {
+    uint32_t pid;
+    size_t live_bytes;
+    size_t live_blocks;
+} memtrace_owner_t;
+
+typedef struct {
+    void* site;
+    size_t live_bytes;
+    size_t live_blocks;
+} memtrace_site_t;
+
+typedef struct {
+    size_t live_bytes;
+    size_t live_blocks;
+    size_t leaked_bytes;
+    size_t leaked_blocks;
+    uint64_t events;
+    uint64_t dropped; // Ring entries overwritten before memtrace_read saw them
+    memtrace_owner_t owners[MEMTRACE_TOP]; // Largest first
+    size_t owner_count;
+    memtrace_site_t sites[MEMTRACE_TOP];
+    size_t site_count;
+} memtrace_snapshot_t;
+
+// Function declarations
+int memtrace_init(void);
+void memtrace_cleanup(void);
+
+// Called by the allocator while tracing is on
+void memtrace_alloc(void* ptr, size_t size, void* site, uint32_t pid);
+void memtrace_free(void* ptr);
+
+// Consumers
+size_t memtrace_read(memtrace_event_t* events, size_t max);
+int memtrace_snapshot(memtrace_snapshot_t* snapshot);
+size_t memtrace_check_leaks(uint32_t pid);
+
+#endif // MEMTRACE_H
@@ -0,0 +1,991 @@
+#define _GNU_SOURCE
+#include "paging.h"
+#include "kernel.h"
+#include "slab.h"
+#include "zram.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define PAGING_NONE UINT32_MAX
+
+static paging_frame_t* frames = NULL;
+static uint32_t frame_count = 0;
+static uint32_t clock_hand = PAGING_NONE;
+static tlb_entry_t tlb[PAGING_TLB_ENTRIES];
+static swap_area_t swap = {-1, 0, 0, NULL, 0, NULL};
+static kmem_cache_t* mapping_cache = NULL;
+static paging_stats_t paging_stats = {0};
+static uint32_t next_asid = 1;
+static uint32_t* merge_buckets = NULL;
+static uint32_t merge_mask = 0;
+static uint32_t merge_cursor = 0;
+static paging_mapping_t* merge_spare = NULL; // Record for the next merge
+static uint64_t merge_changes = 0;    // Frames mapped and writable entries handed out
+static uint64_t merge_sweep_mark = 0; // merge_changes when the current sweep began
+static int merge_sweep_busy = 1;      // The current sweep found something to do
+static int merge_idle = 0;            // The last sweep found nothing; wait for a change
+
+// Software TLB
+static tlb_entry_t* tlb_slot(const address_space_t* space, uint32_t vpn) {
+    return &tlb[(vpn ^ (space->asid * 0x9E3779B1u)) & (PAGING_TLB_ENTRIES - 1)];
+}
+
+static void tlb_invalidate(const address_space_t* space, vaddr_t addr) {
+    uint32_t vpn = addr >> PAGING_PAGE_SHIFT;
+    tlb_entry_t* entry = tlb_slot(space, vpn);
+    if (entry->space == space && entry->vpn == vpn) {
+        entry->space = NULL;
+    }
+}
+
+static void tlb_flush_space(const address_space_t* space) {
+    for (int i = 0; i < PAGING_TLB_ENTRIES; i++) {
+        if (tlb[i].space == space) {
+            tlb[i].space = NULL;
+        }
+    }
+}
+
+// Make every cached entry read-only, so the next write to any page faults
+static void tlb_revoke_writes(void) {
+    for (int i = 0; i < PAGING_TLB_ENTRIES; i++) {
+        tlb[i].writable = 0;
+    }
+}
+
+// Swap slots
+static uint32_t swap_alloc_slot(void) {
+    if (swap.free_count == 0) return PAGING_NONE;
+    
+    uint32_t slot = swap.free_slots[--swap.free_count];
+    swap.slot_refs[slot] = 1;
+    return slot;
+}
+
+static int swap_ref_slot(uint32_t slot) {
+    if (swap.slot_refs[slot] == UINT16_MAX) return -1;
+    swap.slot_refs[slot]++;
+    return 0;
+}
+
+static void swap_free_slot(uint32_t slot) {
+    if (--swap.slot_refs[slot] == 0) {
+        swap.free_slots[swap.free_count++] = slot;
+    }
+}
+
+static int swap_io(uint32_t slot, void* page, int write) {
+    off_t offset = (off_t)(swap.offset + ((uint64_t)slot << PAGING_PAGE_SHIFT));
+    ssize_t done = write ? pwrite(swap.fd, page, PAGING_PAGE_SIZE, offset)
+                         : pread(swap.fd, page, PAGING_PAGE_SIZE, offset);
+    return done == (ssize_t)PAGING_PAGE_SIZE ? 0 : -1;
+}
+
+// CLOCK ring of resident frames
+static void clock_insert(uint32_t frame) {
+    paging_stats.resident_frames++;
+    
+    if (clock_hand == PAGING_NONE) {
+        frames[frame].prev = frame;
+        frames[frame].next = frame;
+        clock_hand = frame;
+        return;
+    }
+    
+    // Insert just behind the hand so the new page gets a full sweep
+    uint32_t prev = frames[clock_hand].prev;
+    frames[frame].prev = prev;
+    frames[frame].next = clock_hand;
+    frames[prev].next = frame;
+    frames[clock_hand].prev = frame;
+}
+
+static void clock_remove(uint32_t frame) {
+    if (frames[frame].next == frame) {
+        clock_hand = PAGING_NONE;
+    } else {
+        frames[frames[frame].prev].next = frames[frame].next;
+        frames[frames[frame].next].prev = frames[frame].prev;
+        if (clock_hand == frame) {
+            clock_hand = frames[frame].next;
+        }
+    }
+    paging_stats.resident_frames--;
+}
+
+// Same-page merging table, keyed by content checksum
+static uint64_t merge_checksum(const uint8_t* page) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < PAGING_PAGE_SIZE; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, page + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001B3ull;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+static void merge_insert(uint32_t frame, uint8_t state) {
+    uint32_t* bucket = &merge_buckets[frames[frame].checksum & merge_mask];
+    frames[frame].merge_next = *bucket;
+    frames[frame].merge_state = state;
+    *bucket = frame;
+}
+
+static void merge_unlink(uint32_t frame) {
+    if (frames[frame].merge_state == PAGING_MERGE_NONE) return;
+    
+    uint32_t* link = &merge_buckets[frames[frame].checksum & merge_mask];
+    while (*link != PAGING_NONE && *link != frame) {
+        link = &frames[*link].merge_next;
+    }
+    if (*link == frame) {
+        *link = frames[frame].merge_next;
+    }
+    frames[frame].merge_state = PAGING_MERGE_NONE;
+}
+
+// Find another frame in the table with the same contents
+static uint32_t merge_lookup(uint32_t frame) {
+    const uint8_t* page = memory_page_address(frame);
+    uint32_t other = merge_buckets[frames[frame].checksum & merge_mask];
+    
+    for (; other != PAGING_NONE; other = frames[other].merge_next) {
+        if (other != frame && frames[other].checksum == frames[frame].checksum &&
+            memcmp(memory_page_address(other), page, PAGING_PAGE_SIZE) == 0) {
+            return other;
+        }
+    }
+    return PAGING_NONE;
+}
+
+// Record that a virtual page maps the frame, with a record allocated
+// beforehand. Allocating can reclaim frames, so a frame already on the
+// CLOCK ring must only be looked at once the record is in hand.
+static void frame_link(uint32_t frame, paging_mapping_t* mapping, address_space_t* space, vaddr_t vaddr) {
+    mapping->space = space;
+    mapping->vaddr = vaddr;
+    mapping->next = frames[frame].mappings;
+    frames[frame].mappings = mapping;
+    frames[frame].refcount++;
+    merge_changes++;
+}
+
+// For frames not on the CLOCK ring yet, which reclaim cannot take
+static int frame_map(uint32_t frame, address_space_t* space, vaddr_t vaddr) {
+    paging_mapping_t* mapping = kmem_cache_alloc(mapping_cache);
+    if (!mapping) return -1;
+    
+    frame_link(frame, mapping, space, vaddr);
+    return 0;
+}
+
+// Drop one mapping; the last one takes the frame off the ring and frees it
+static void frame_unmap(uint32_t frame, address_space_t* space, vaddr_t vaddr) {
+    paging_mapping_t** link = &frames[frame].mappings;
+    while (*link && ((*link)->space != space || (*link)->vaddr != vaddr)) {
+        link = &(*link)->next;
+    }
+    if (*link) {
+        paging_mapping_t* mapping = *link;
+        *link = mapping->next;
+        kmem_cache_free(mapping_cache, mapping);
+    }
+    
+    if (--frames[frame].refcount == 0) {
+        merge_unlink(frame);
+        frames[frame].checksum = 0;
+        clock_remove(frame);
+        memory_free(memory_page_address(frame));
+    }
+}
+
+static pte_t* paging_walk(address_space_t* space, vaddr_t addr, int create) {
+    uint32_t dir = addr >> (PAGING_PAGE_SHIFT + PAGING_TABLE_BITS);
+    uint32_t index = (addr >> PAGING_PAGE_SHIFT) & (PAGING_TABLE_ENTRIES - 1);
+    
+    if (!space->tables[dir]) {
+        if (!create) return NULL;
+        
+        pte_t* table = memory_alloc(PAGING_TABLE_ENTRIES * sizeof(pte_t));
+        if (!table) return NULL;
+        memset(table, 0, PAGING_TABLE_ENTRIES * sizeof(pte_t));
+        space->tables[dir] = table;
+    }
+    
+    return &space->tables[dir][index];
+}
+
+int paging_init(const char* swap_path) {
+    frame_count = memory_page_count();
+    frames = calloc(frame_count, sizeof(paging_frame_t));
+    if (!frames) return -1;
+    
+    mapping_cache = kmem_cache_create("paging_mapping", sizeof(paging_mapping_t));
+    if (!mapping_cache) {
+        free(frames);
+        frames = NULL;
+        return -1;
+    }
+    
+    // About one bucket per four frames; only process pages ever get hashed
+    uint32_t buckets = 64;
+    while (buckets < frame_count / 4) {
+        buckets <<= 1;
+    }
+    merge_buckets = malloc(sizeof(uint32_t) * buckets);
+    if (!merge_buckets) {
+        free(frames);
+        frames = NULL;
+        return -1;
+    }
+    memset(merge_buckets, 0xFF, sizeof(uint32_t) * buckets);
+    merge_mask = buckets - 1;
+    merge_cursor = 0;
+    merge_sweep_busy = 1;
+    merge_idle = 0;
+    
+    memset(tlb, 0, sizeof(tlb));
+    memset(&paging_stats, 0, sizeof(paging_stats));
+    clock_hand = PAGING_NONE;
+    
+    if (!swap_path) {
+        printf("Paging: No disk image, swapping disabled\n");
+        return 0;
+    }
+    
+    swap.fd = open(swap_path, O_RDWR);
+    struct stat st;
+    if (swap.fd < 0 || fstat(swap.fd, &st) != 0) {
+        fprintf(stderr, "Paging: Cannot open disk image %s, swapping disabled\n", swap_path);
+        if (swap.fd >= 0) close(swap.fd);
+        swap.fd = -1;
+        return 0;
+    }
+    
+    uint64_t region = ((uint64_t)st.st_size / PAGING_SWAP_FRACTION) & ~(uint64_t)(PAGING_PAGE_SIZE - 1);
+    uint64_t slots = region >> PAGING_PAGE_SHIFT;
+    if (slots > UINT32_MAX - 1) {
+        slots = UINT32_MAX - 1;
+    }
+    
+    swap.slot_count = (uint32_t)slots;
+    swap.offset = (uint64_t)st.st_size - region;
+    swap.free_slots = malloc(sizeof(uint32_t) * (swap.slot_count ? swap.slot_count : 1));
+    swap.slot_refs = calloc(swap.slot_count ? swap.slot_count : 1, sizeof(uint16_t));
+    if (!swap.free_slots || !swap.slot_refs) {
+        free(swap.free_slots);
+        free(swap.slot_refs);
+        swap.free_slots = NULL;
+        swap.slot_refs = NULL;
+        close(swap.fd);
+        swap.fd = -1;
+        return -1;
+    }
+    
+    // Hand out low slots first
+    for (uint32_t i = 0; i < swap.slot_count; i++) {
+        swap.free_slots[i] = swap.slot_count - 1 - i;
+    }
+    swap.free_count = swap.slot_count;
+    paging_stats.swap_total = swap.slot_count;
+    
+    printf("Paging: Swap area of %u pages in %s\n", swap.slot_count, swap_path);
+    return 0;
+}
+
+void paging_cleanup(void) {
+    // Frames and page tables live in the arena and go away with it
+    if (frames) {
+        free(frames);
+        frames = NULL;
+    }
+    if (merge_buckets) {
+        free(merge_buckets);
+        merge_buckets = NULL;
+    }
+    if (swap.free_slots) {
+        free(swap.free_slots);
+        swap.free_slots = NULL;
+    }
+    if (swap.slot_refs) {
+        free(swap.slot_refs);
+        swap.slot_refs = NULL;
+    }
+    if (swap.fd >= 0) {
+        close(swap.fd);
+        swap.fd = -1;
+    }
+    swap.slot_count = 0;
+    swap.free_count = 0;
+    frame_count = 0;
+    clock_hand = PAGING_NONE;
+    mapping_cache = NULL;
+    merge_spare = NULL;
+    memset(tlb, 0, sizeof(tlb));
+}
+
+address_space_t* paging_create_space(void) {
+    address_space_t* space = memory_alloc(sizeof(address_space_t));
+    if (!space) return NULL;
+    
+    memset(space, 0, sizeof(*space));
+    space->asid = next_asid++;
+    return space;
+}
+
+void paging_destroy_space(address_space_t* space) {
+    if (!space) return;
+    
+    tlb_flush_space(space);
+    
+    for (uint32_t dir = 0; dir < PAGING_DIR_ENTRIES; dir++) {
+        pte_t* table = space->tables[dir];
+        if (!table) continue;
+        
+        for (uint32_t i = 0; i < PAGING_TABLE_ENTRIES; i++) {
+            pte_t pte = table[i];
+            if (pte & PTE_PRESENT) {
+                vaddr_t vaddr = (dir << (PAGING_PAGE_SHIFT + PAGING_TABLE_BITS)) | (i << PAGING_PAGE_SHIFT);
+                frame_unmap((uint32_t)(pte >> PAGING_PAGE_SHIFT), space, vaddr);
+            } else if (pte & PTE_SWAPPED) {
+                swap_free_slot((uint32_t)(pte >> PAGING_PAGE_SHIFT));
+            } else if (pte & PTE_ZRAM) {
+                zram_free((uint32_t)(pte >> PAGING_PAGE_SHIFT));
+            }
+        }
+        memory_free(table);
+    }
+    
+    memory_free(space);
+}
+
+// Share every page of the source below limit with a new space. Writable
+// pages become copy-on-write in both, so only the page tables are copied here.
+address_space_t* paging_clone_space(address_space_t* source, uint64_t limit) {
+    if (!source) return NULL;
+    
+    address_space_t* space = paging_create_space();
+    if (!space) return NULL;
+    
+    paging_mapping_t* spare = NULL;
+    for (uint32_t dir = 0; dir < PAGING_DIR_ENTRIES; dir++) {
+        pte_t* source_table = source->tables[dir];
+        if ((uint64_t)dir << (PAGING_PAGE_SHIFT + PAGING_TABLE_BITS) >= limit) break;
+        if (!source_table) continue;
+        
+        pte_t* table = paging_walk(space, dir << (PAGING_PAGE_SHIFT + PAGING_TABLE_BITS), 1);
+        if (!table) goto fail;
+        
+        for (uint32_t i = 0; i < PAGING_TABLE_ENTRIES; i++) {
+            pte_t pte = source_table[i];
+            vaddr_t vaddr = (dir << (PAGING_PAGE_SHIFT + PAGING_TABLE_BITS)) | (i << PAGING_PAGE_SHIFT);
+            if (vaddr >= limit) break;
+            
+            // The allocation may evict this very frame, so read the entry again
+            if ((pte & PTE_PRESENT) && !spare) {
+                spare = kmem_cache_alloc(mapping_cache);
+                if (!spare) goto fail;
+                pte = source_table[i];
+            }
+            
+            if (pte & PTE_PRESENT) {
+                frame_link((uint32_t)(pte >> PAGING_PAGE_SHIFT), spare, space, vaddr);
+                spare = NULL;
+                space->resident_pages++;
+            } else if (pte & PTE_SWAPPED) {
+                if (swap_ref_slot((uint32_t)(pte >> PAGING_PAGE_SHIFT)) != 0) goto fail;
+                space->swapped_pages++;
+            } else if (pte & PTE_ZRAM) {
+                if (zram_ref((uint32_t)(pte >> PAGING_PAGE_SHIFT)) != 0) goto fail;
+                space->compressed_pages++;
+            } else {
+                table[i] = pte; // Demand-zero pages need no sharing
+                continue;
+            }
+            
+            if (pte & PTE_WRITE) {
+                pte = (pte & ~(pte_t)PTE_WRITE) | PTE_COW;
+                source_table[i] = pte;
+                tlb_invalidate(source, vaddr);
+            }
+            table[i] = pte & ~(pte_t)PTE_ACCESSED;
+        }
+    }
+    
+    if (spare) {
+        kmem_cache_free(mapping_cache, spare);
+    }
+    return space;
+
+fail:
+    if (spare) {
+        kmem_cache_free(mapping_cache, spare);
+    }
+    paging_destroy_space(space);
+    return NULL;
+}
+
+// Give a faulting space its own copy of a shared frame
+static int paging_cow_break(address_space_t* space, vaddr_t addr, pte_t* pte) {
+    uint32_t frame = (uint32_t)(*pte >> PAGING_PAGE_SHIFT);
+    vaddr_t vaddr = addr & ~(vaddr_t)(PAGING_PAGE_SIZE - 1);
+    
+    if (frames[frame].refcount == 1) {
+        // A merged frame about to change can no longer stand for its contents
+        merge_unlink(frame);
+        *pte = (*pte & ~(pte_t)PTE_COW) | PTE_WRITE;
+        paging_stats.cow_reuses++;
+        return 0;
+    }
+    
+    // Shared frames are never evicted, so the source survives this allocation
+    uint8_t* page = memory_alloc(PAGING_PAGE_SIZE);
+    if (!page) return -1;
+    
+    uint32_t copy = memory_page_index(page);
+    if (frame_map(copy, space, vaddr) != 0) {
+        memory_free(page);
+        return -1;
+    }
+    memcpy(page, memory_page_address(frame), PAGING_PAGE_SIZE);
+    clock_insert(copy);
+    frame_unmap(frame, space, vaddr);
+    
+    *pte = ((pte_t)copy << PAGING_PAGE_SHIFT) | PTE_VALID | PTE_WRITE | PTE_PRESENT | PTE_DIRTY;
+    tlb_invalidate(space, vaddr);
+    paging_stats.cow_copies++;
+    return 0;
+}
+
+int paging_reserve(address_space_t* space, vaddr_t addr, size_t size, int writable) {
+    if (!space || size == 0) return -1;
+    
+    uint64_t start = addr & ~(vaddr_t)(PAGING_PAGE_SIZE - 1);
+    uint64_t end = ((uint64_t)addr + size + PAGING_PAGE_SIZE - 1) & ~(uint64_t)(PAGING_PAGE_SIZE - 1);
+    if (end > ((uint64_t)1 << 32)) return -1;
+    
+    for (uint64_t page = start; page < end; page += PAGING_PAGE_SIZE) {
+        pte_t* pte = paging_walk(space, (vaddr_t)page, 1);
+        if (!pte) return -1;
+        
+        if (!(*pte & PTE_VALID)) {
+            *pte = PTE_VALID | (writable ? PTE_WRITE : 0);
+        }
+    }
+    
+    return 0;
+}
+
+// Drop the mappings of a page range; returns how many pages were mapped
+size_t paging_unmap(address_space_t* space, vaddr_t addr, size_t pages) {
+    size_t unmapped = 0;
+    if (!space) return 0;
+    
+    vaddr_t vaddr = addr & ~(vaddr_t)(PAGING_PAGE_SIZE - 1);
+    for (size_t i = 0; i < pages; i++, vaddr += PAGING_PAGE_SIZE) {
+        pte_t* pte = paging_walk(space, vaddr, 0);
+        if (!pte || !(*pte & PTE_VALID)) continue;
+        
+        if (*pte & PTE_PRESENT) {
+            frame_unmap((uint32_t)(*pte >> PAGING_PAGE_SHIFT), space, vaddr);
+            space->resident_pages--;
+        } else if (*pte & PTE_SWAPPED) {
+            swap_free_slot((uint32_t)(*pte >> PAGING_PAGE_SHIFT));
+            space->swapped_pages--;
+        } else if (*pte & PTE_ZRAM) {
+            zram_free((uint32_t)(*pte >> PAGING_PAGE_SHIFT));
+            space->compressed_pages--;
+        }
+        *pte = 0;
+        tlb_invalidate(space, vaddr);
+        unmapped++;
+    }
+    
+    paging_stats.pages_unmapped += unmapped;
+    return unmapped;
+}
+
+// Hand one page to another space: the frame's reverse mapping is relinked,
+// the entry moves over and the source is left demand-zero
+static void paging_move_page(address_space_t* from, vaddr_t src, pte_t* source,
+                             address_space_t* to, vaddr_t dst, pte_t* target) {
+    pte_t pte = *source;
+    
+    if (pte & PTE_PRESENT) {
+        paging_mapping_t* mapping = frames[pte >> PAGING_PAGE_SHIFT].mappings;
+        while (mapping && (mapping->space != from || mapping->vaddr != src)) {
+            mapping = mapping->next;
+        }
+        if (mapping) {
+            mapping->space = to;
+            mapping->vaddr = dst;
+        }
+        from->resident_pages--;
+        to->resident_pages++;
+    } else if (pte & PTE_SWAPPED) {
+        from->swapped_pages--;
+        to->swapped_pages++;
+    } else if (pte & PTE_ZRAM) {
+        from->compressed_pages--;
+        to->compressed_pages++;
+    }
+    
+    *target = pte;
+    *source = PTE_VALID | ((pte & (PTE_WRITE | PTE_COW)) ? PTE_WRITE : 0);
+    tlb_invalidate(from, src);
+    tlb_invalidate(to, dst);
+}
+
+// Share one page read-only, the way paging_clone_space shares a whole space.
+// The record in *spare is used up when the page is resident.
+static int paging_grant_page(address_space_t* from, vaddr_t src, pte_t* source,
+                             address_space_t* to, vaddr_t dst, pte_t* target,
+                             paging_mapping_t** spare) {
+    // The allocation may evict the source frame, so read the entry after it
+    if (!*spare) {
+        *spare = kmem_cache_alloc(mapping_cache);
+        if (!*spare) return -1;
+    }
+    pte_t pte = *source;
+    
+    if (pte & PTE_PRESENT) {
+        frame_link((uint32_t)(pte >> PAGING_PAGE_SHIFT), *spare, to, dst);
+        *spare = NULL;
+        to->resident_pages++;
+    } else if (pte & PTE_SWAPPED) {
+        if (swap_ref_slot((uint32_t)(pte >> PAGING_PAGE_SHIFT)) != 0) return -1;
+        to->swapped_pages++;
+    } else if (pte & PTE_ZRAM) {
+        if (zram_ref((uint32_t)(pte >> PAGING_PAGE_SHIFT)) != 0) return -1;
+        to->compressed_pages++;
+    }
+    
+    // Later writes by the sender copy instead of showing through
+    if (pte & PTE_WRITE) {
+        *source = (pte & ~(pte_t)PTE_WRITE) | PTE_COW;
+        tlb_invalidate(from, src);
+    }
+    *target = pte & ~(pte_t)(PTE_WRITE | PTE_COW | PTE_ACCESSED);
+    tlb_invalidate(to, dst);
+    return 0;
+}
+
+// Pass whole pages between spaces by page table updates alone; no page
+// contents are copied. Every source page must be mapped and every
+// destination page unmapped, or nothing changes.
+int paging_transfer(address_space_t* from, vaddr_t src, address_space_t* to, vaddr_t dst, size_t pages, int mode) {
+    uint64_t length = (uint64_t)pages << PAGING_PAGE_SHIFT;
+    if (!from || !to || pages == 0 || ((src | dst) & (PAGING_PAGE_SIZE - 1)) ||
+        src + length > ((uint64_t)1 << 32) || dst + length > ((uint64_t)1 << 32)) {
+        return -1;
+    }
+    if (from == to && src < dst + length && dst < src + length) return -1;
+    
+    for (size_t i = 0; i < pages; i++) {
+        pte_t* source = paging_walk(from, src + (vaddr_t)(i << PAGING_PAGE_SHIFT), 0);
+        pte_t* target = paging_walk(to, dst + (vaddr_t)(i << PAGING_PAGE_SHIFT), 1);
+        if (!source || !(*source & PTE_VALID) || !target || (*target & PTE_VALID)) {
+            return -1;
+        }
+    }
+    
+    paging_mapping_t* spare = NULL;
+    for (size_t i = 0; i < pages; i++) {
+        vaddr_t from_addr = src + (vaddr_t)(i << PAGING_PAGE_SHIFT);
+        vaddr_t to_addr = dst + (vaddr_t)(i << PAGING_PAGE_SHIFT);
+        pte_t* source = paging_walk(from, from_addr, 0);
+        pte_t* target = paging_walk(to, to_addr, 0);
+        
+        if (mode == PAGING_TRANSFER_MOVE) {
+            paging_move_page(from, from_addr, source, to, to_addr, target);
+            paging_stats.pages_moved++;
+        } else if (paging_grant_page(from, from_addr, source, to, to_addr, target, &spare) == 0) {
+            paging_stats.pages_granted++;
+        } else {
+            // Sender pages already made copy-on-write stay that way; with
+            // the frame unshared again their next write reuses it
+            if (spare) kmem_cache_free(mapping_cache, spare);
+            paging_unmap(to, dst, i);
+            return -1;
+        }
+    }
+    
+    if (spare) kmem_cache_free(mapping_cache, spare);
+    return 0;
+}
+
+// Slow path: walk the tables, fault the page in and refill the TLB
+static void* paging_fault(address_space_t* space, vaddr_t addr, int write) {
+    pte_t* pte = paging_walk(space, addr, 0);
+    vaddr_t vaddr = addr & ~(vaddr_t)(PAGING_PAGE_SIZE - 1);
+    
+    if (!pte || !(*pte & PTE_VALID) || (write && !(*pte & (PTE_WRITE | PTE_COW)))) {
+        paging_stats.faults++;
+        return NULL;
+    }
+    
+    if (!(*pte & PTE_PRESENT)) {
+        // May reclaim other frames, but never touches this table
+        uint8_t* page = memory_alloc(PAGING_PAGE_SIZE);
+        if (!page) {
+            paging_stats.faults++;
+            return NULL;
+        }
+        
+        pte_t flags = *pte & (PTE_VALID | PTE_WRITE);
+        if (*pte & PTE_COW) {
+            flags |= PTE_WRITE; // A freshly read page is private
+        }
+        
+        uint32_t slot = PAGING_NONE;
+        if (*pte & (PTE_SWAPPED | PTE_ZRAM)) {
+            slot = (uint32_t)(*pte >> PAGING_PAGE_SHIFT);
+            int failed = (*pte & PTE_SWAPPED) ? swap_io(slot, page, 0) : zram_load(slot, page);
+            if (failed) {
+                memory_free(page);
+                paging_stats.faults++;
+                return NULL;
+            }
+            flags |= PTE_DIRTY; // This space's hold on the stored copy goes away
+        } else {
+            memset(page, 0, PAGING_PAGE_SIZE);
+        }
+        
+        uint32_t frame = memory_page_index(page);
+        if (frame_map(frame, space, vaddr) != 0) {
+            memory_free(page);
+            paging_stats.faults++;
+            return NULL;
+        }
+        
+        if (*pte & PTE_SWAPPED) {
+            swap_free_slot(slot);
+            space->swapped_pages--;
+            paging_stats.swap_ins++;
+        } else if (*pte & PTE_ZRAM) {
+            zram_free(slot);
+            space->compressed_pages--;
+            paging_stats.zram_ins++;
+        } else {
+            paging_stats.zero_fills++;
+        }
+        
+        clock_insert(frame);
+        space->resident_pages++;
+        
+        *pte = ((pte_t)frame << PAGING_PAGE_SHIFT) | flags | PTE_PRESENT;
+    }
+    
+    if (write && !(*pte & PTE_WRITE)) {
+        if (paging_cow_break(space, addr, pte) != 0) {
+            paging_stats.faults++;
+            return NULL;
+        }
+    }
+    
+    *pte |= PTE_ACCESSED;
+    if (write) {
+        *pte |= PTE_DIRTY;
+        merge_changes++;
+    }
+    
+    // Only hand out a writable entry once the page is marked dirty
+    uint32_t vpn = addr >> PAGING_PAGE_SHIFT;
+    tlb_entry_t* entry = tlb_slot(space, vpn);
+    entry->space = space;
+    entry->vpn = vpn;
+    entry->writable = (*pte & (PTE_WRITE | PTE_DIRTY)) == (PTE_WRITE | PTE_DIRTY);
+    entry->frame = memory_page_address((uint32_t)(*pte >> PAGING_PAGE_SHIFT));
+    
+    return entry->frame + (addr & (PAGING_PAGE_SIZE - 1));
+}
+
+void* paging_translate(address_space_t* space, vaddr_t addr, int write) {
+    if (!space) return NULL;
+    
+    uint32_t vpn = addr >> PAGING_PAGE_SHIFT;
+    tlb_entry_t* entry = tlb_slot(space, vpn);
+    if (entry->space == space && entry->vpn == vpn && (entry->writable || !write)) {
+        paging_stats.tlb_hits++;
+        return entry->frame + (addr & (PAGING_PAGE_SIZE - 1));
+    }
+    
+    paging_stats.tlb_misses++;
+    return paging_fault(space, addr, write);
+}
+
+static size_t paging_copy(address_space_t* space, vaddr_t addr, uint8_t* buffer, size_t size, int write) {
+    size_t done = 0;
+    
+    while (done < size) {
+        uint64_t current = (uint64_t)addr + done;
+        if (current > UINT32_MAX) break;
+        
+        uint8_t* host = paging_translate(space, (vaddr_t)current, write);
+        if (!host) break;
+        
+        size_t chunk = PAGING_PAGE_SIZE - (current & (PAGING_PAGE_SIZE - 1));
+        if (chunk > size - done) {
+            chunk = size - done;
+        }
+        
+        if (write) {
+            memcpy(host, buffer + done, chunk);
+        } else {
+            memcpy(buffer + done, host, chunk);
+        }
+        done += chunk;
+    }
+    
+    return done;
+}
+
+size_t paging_read(address_space_t* space, vaddr_t addr, void* buffer, size_t size) {
+    return paging_copy(space, addr, buffer, size, 0);
+}
+
+size_t paging_write(address_space_t* space, vaddr_t addr, const void* data, size_t size) {
+    return paging_copy(space, addr, (uint8_t*)(uintptr_t)data, size, 1);
+}
+
+// Move a dirty victim into zram. The frame is freed before the compressed
+// copy is allocated, so this still works when the arena is full. Returns 0
+// once evicted, -1 to try swap instead and 1 if the page was put back.
+static int paging_compress_out(uint32_t frame, address_space_t* owner, vaddr_t vaddr, pte_t* pte) {
+    zram_packed_t packed;
+    if (zram_pack(memory_page_address(frame), &packed) != 0) return -1;
+    
+    pte_t flags = *pte & (PTE_VALID | PTE_WRITE | PTE_COW);
+    tlb_invalidate(owner, vaddr);
+    frame_unmap(frame, owner, vaddr);
+    
+    uint32_t handle = zram_store(&packed);
+    if (handle != ZRAM_NONE) {
+        *pte = ((pte_t)handle << PAGING_PAGE_SHIFT) | flags | PTE_ZRAM;
+        owner->resident_pages--;
+        owner->compressed_pages++;
+        paging_stats.zram_outs++;
+        return 0;
+    }
+    
+    // The page just freed normally covers the store; if not, bring it back
+    uint8_t* page = memory_alloc(PAGING_PAGE_SIZE);
+    uint32_t copy = page ? memory_page_index(page) : PAGING_NONE;
+    if (!page || zram_unpack(&packed, page) != 0 || frame_map(copy, owner, vaddr) != 0) {
+        fprintf(stderr, "Paging: Lost page %08x while compressing it\n", (unsigned)vaddr);
+        memory_free(page);
+        *pte = flags;
+        owner->resident_pages--;
+        return 0;
+    }
+    clock_insert(copy);
+    *pte = ((pte_t)copy << PAGING_PAGE_SHIFT) | flags | PTE_PRESENT | PTE_DIRTY;
+    return 1;
+}
+
+// Evict one frame chosen by the CLOCK hand. Returns 0 if nothing could go.
+static int paging_evict_one(void) {
+    if (clock_hand == PAGING_NONE) return 0;
+    
+    // Two sweeps clear every accessed bit, so a victim is found unless
+    // every resident frame is shared
+    size_t limit = 2 * paging_stats.resident_frames + 1;
+    for (size_t step = 0; step < limit; step++) {
+        uint32_t frame = clock_hand;
+        clock_hand = frames[frame].next;
+        
+        // Shared frames stay put until copy-on-write splits them
+        if (frames[frame].refcount != 1) continue;
+        
+        address_space_t* owner = frames[frame].mappings->space;
+        vaddr_t vaddr = frames[frame].mappings->vaddr;
+        pte_t* pte = paging_walk(owner, vaddr, 0);
+        
+        if (*pte & PTE_ACCESSED) {
+            // Second chance; drop the TLB entry so the next access sets it again
+            *pte &= ~(pte_t)PTE_ACCESSED;
+            tlb_invalidate(owner, vaddr);
+            continue;
+        }
+        
+        // Compressed memory first, the disk image for what zram turns away
+        if (*pte & PTE_DIRTY) {
+            int result = paging_compress_out(frame, owner, vaddr, pte);
+            if (result == 0) return 1;
+            if (result > 0) continue;
+        }
+        
+        pte_t flags = *pte & (PTE_VALID | PTE_WRITE | PTE_COW);
+        if (*pte & PTE_DIRTY) {
+            uint32_t slot = swap_alloc_slot();
+            if (slot == PAGING_NONE) continue;
+            
+            if (swap_io(slot, memory_page_address(frame), 1) != 0) {
+                swap_free_slot(slot);
+                continue;
+            }
+            *pte = ((pte_t)slot << PAGING_PAGE_SHIFT) | flags | PTE_SWAPPED;
+            owner->swapped_pages++;
+            paging_stats.swap_outs++;
+        } else {
+            // Still all zeroes; the next touch zero-fills it again
+            *pte = flags;
+            paging_stats.discards++;
+        }
+        
+        tlb_invalidate(owner, vaddr);
+        owner->resident_pages--;
+        frame_unmap(frame, owner, vaddr);
+        return 1;
+    }
+    
+    return 0;
+}
+
+size_t paging_reclaim(size_t pages) {
+    size_t reclaimed = 0;
+    
+    if (!frames) return 0;
+    
+    while (reclaimed < pages && paging_evict_one()) {
+        reclaimed++;
+    }
+    
+    return reclaimed;
+}
+
+// Write-protect every mapping of a frame that becomes shared by merging
+static void merge_protect(uint32_t frame) {
+    for (paging_mapping_t* mapping = frames[frame].mappings; mapping; mapping = mapping->next) {
+        pte_t* pte = paging_walk(mapping->space, mapping->vaddr, 0);
+        if (*pte & PTE_WRITE) {
+            *pte = (*pte & ~(pte_t)PTE_WRITE) | PTE_COW;
+        }
+        tlb_invalidate(mapping->space, mapping->vaddr);
+    }
+}
+
+// Point the single mapping of a private frame at a stable frame with the
+// same contents and free the private copy. Uses up merge_spare: allocating
+// here could reclaim either frame.
+static void merge_into(uint32_t frame, uint32_t stable) {
+    address_space_t* space = frames[frame].mappings->space;
+    vaddr_t vaddr = frames[frame].mappings->vaddr;
+    pte_t* pte = paging_walk(space, vaddr, 0);
+    
+    frame_link(stable, merge_spare, space, vaddr);
+    merge_spare = NULL;
+    
+    pte_t flags = *pte & (PTE_VALID | PTE_WRITE | PTE_COW | PTE_ACCESSED | PTE_DIRTY);
+    if (flags & PTE_WRITE) {
+        flags = (flags & ~(pte_t)PTE_WRITE) | PTE_COW;
+    }
+    *pte = ((pte_t)stable << PAGING_PAGE_SHIFT) | flags | PTE_PRESENT;
+    tlb_invalidate(space, vaddr);
+    
+    frame_unmap(frame, space, vaddr);
+    paging_stats.merge_merged++;
+}
+
+// Visit the next count frames of the arena. A private process page whose
+// checksum held still since the last visit is merged with an identical
+// page if the table has one, and becomes a merge candidate otherwise.
+// Writes to merged pages go through copy-on-write.
+size_t paging_merge_scan(size_t count) {
+    size_t merged = 0;
+    
+    if (!frames || !merge_buckets) return 0;
+    
+    // Pages only change through a fault or a new mapping once a sweep has
+    // revoked the cached writable entries, so a quiet sweep can rest
+    if (merge_idle) {
+        if (merge_changes == merge_sweep_mark) return 0;
+        merge_idle = 0;
+    }
+    
+    struct timespec start, end;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+    
+    for (size_t i = 0; i < count; i++) {
+        // Allocate before looking at any frame, since it may reclaim some
+        if (!merge_spare) {
+            merge_spare = kmem_cache_alloc(mapping_cache);
+            if (!merge_spare) break;
+        }
+        
+        if (merge_cursor == 0) {
+            if (!merge_sweep_busy && merge_changes == merge_sweep_mark) {
+                merge_idle = 1;
+                break;
+            }
+            tlb_revoke_writes();
+            merge_sweep_mark = merge_changes;
+            merge_sweep_busy = 0;
+        }
+        
+        uint32_t frame = merge_cursor;
+        if (++merge_cursor == frame_count) {
+            merge_cursor = 0;
+            paging_stats.merge_passes++;
+        }
+        
+        // Only private process pages; stable frames already stand for theirs
+        if (!frames[frame].mappings || frames[frame].refcount != 1 ||
+            frames[frame].merge_state == PAGING_MERGE_STABLE) {
+            continue;
+        }
+        
+        paging_stats.merge_scanned++;
+        uint64_t checksum = merge_checksum(memory_page_address(frame));
+        if (checksum != frames[frame].checksum) {
+            // Still changing; try again next pass
+            merge_unlink(frame);
+            merge_sweep_busy = 1;
+            frames[frame].checksum = checksum;
+            continue;
+        }
+        
+        uint32_t match = merge_lookup(frame);
+        if (match == PAGING_NONE) {
+            if (frames[frame].merge_state == PAGING_MERGE_NONE) {
+                merge_insert(frame, PAGING_MERGE_CANDIDATE);
+                merge_sweep_busy = 1;
+            }
+            continue;
+        }
+        
+        if (frames[match].merge_state == PAGING_MERGE_CANDIDATE) {
+            merge_protect(match);
+            frames[match].merge_state = PAGING_MERGE_STABLE;
+        }
+        merge_into(frame, match);
+        merged++;
+    }
+    
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+    paging_stats.merge_scan_ns += (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ull +
+                                  (uint64_t)end.tv_nsec - (uint64_t)start.tv_nsec;
+    return merged;
+}
+
+void paging_get_stats(paging_stats_t* stats) {
+    if (!stats) return;
+    
+    *stats = paging_stats;
+    
+    // Every mapping of a stable frame beyond the first would be a frame of its own
+    stats->merge_saved = 0;
+    for (uint32_t frame = 0; frame < frame_count; frame++) {
+        if (frames[frame].merge_state == PAGING_MERGE_STABLE && frames[frame].refcount > 1) {
+            stats->merge_saved += frames[frame].refcount - 1;
+        }
+    }
+    stats->swap_total = swap.slot_count;
+    stats->swap_used = swap.slot_count - swap.free_count;
+}
@@ -0,0 +1,135 @@
+#ifndef PAGING_H
+#define PAGING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Two-level page tables over a 32-bit virtual address space:
+// 11 bits of directory, 9 bits of table, 12 bits of page offset
+#define PAGING_PAGE_SHIFT     12
+#define PAGING_PAGE_SIZE      ((size_t)1 << PAGING_PAGE_SHIFT)
+#define PAGING_TABLE_BITS     9
+#define PAGING_DIR_BITS       11
+#define PAGING_TABLE_ENTRIES  (1u << PAGING_TABLE_BITS)
+#define PAGING_DIR_ENTRIES    (1u << PAGING_DIR_BITS)
+#define PAGING_TLB_ENTRIES    64
+#define PAGING_SWAP_FRACTION  4 // Swap uses the last quarter of the disk image
+#define PAGING_MERGE_BATCH    128 // Frames the merge scanner visits per batch
+#define PAGING_MERGE_INTERVAL 64  // Process switches between merge batches
+
+// Page table entry flags; bits 12 and up hold a frame index or swap slot
+#define PTE_VALID    0x001 // Mapping exists (demand-zero until present)
+#define PTE_PRESENT  0x002 // Backed by a frame
+#define PTE_WRITE    0x004
+#define PTE_ACCESSED 0x008
+#define PTE_DIRTY    0x010 // Frame differs from its backing (zero or swap)
+#define PTE_SWAPPED  0x020 // Contents live in a swap slot
+#define PTE_COW      0x040 // Writable once the shared frame is copied
+#define PTE_ZRAM     0x080 // Contents live in a zram handle
+#define PTE_FLAGS    ((pte_t)PAGING_PAGE_SIZE - 1)
+
+// paging_transfer modes
+#define PAGING_TRANSFER_MOVE  0 // Pages leave the source, which reads back zeros
+#define PAGING_TRANSFER_GRANT 1 // Read-only in the destination, copy-on-write in the source
+
+typedef uint32_t vaddr_t;
+typedef uint64_t pte_t;
+
+// Per-process virtual address space
+typedef struct address_space {
+    pte_t* tables[PAGING_DIR_ENTRIES];
+    uint32_t asid;
+    size_t resident_pages;
+    size_t swapped_pages;
+    size_t compressed_pages;
+} address_space_t;
+
+// One virtual page backed by a frame
+typedef struct paging_mapping {
+    address_space_t* space;
+    vaddr_t vaddr;
+    struct paging_mapping* next;
+} paging_mapping_t;
+
+// Same-page merging state of a frame
+#define PAGING_MERGE_NONE      0
+#define PAGING_MERGE_CANDIDATE 1 // Unchanged since the last scan, still private
+#define PAGING_MERGE_STABLE    2 // Shared read-only by every page with this content
+
+// Reverse map from an arena page to the virtual pages it backs
+typedef struct {
+    paging_mapping_t* mappings;
+    uint32_t refcount;
+    uint32_t prev; // CLOCK ring links
+    uint32_t next;
+    uint64_t checksum;   // Content hash from the last merge scan
+    uint32_t merge_next; // Merge table chain
+    uint8_t merge_state;
+} paging_frame_t;
+
+// Software TLB entry
+typedef struct {
+    address_space_t* space;
+    uint32_t vpn;
+    int writable;
+    uint8_t* frame;
+} tlb_entry_t;
+
+// Swap area inside the disk image
+typedef struct {
+    int fd;
+    uint64_t offset;
+    uint32_t slot_count;
+    uint32_t* free_slots;
+    uint32_t free_count;
+    uint16_t* slot_refs; // Slots stay shared between clones until read back
+} swap_area_t;
+
+typedef struct {
+    size_t zero_fills;
+    size_t swap_ins;
+    size_t swap_outs;
+    size_t zram_ins;
+    size_t zram_outs;
+    size_t discards;  // Clean zero pages dropped without I/O
+    size_t faults;    // Invalid or protection faults
+    size_t cow_copies;
+    size_t cow_reuses; // Write faults on frames no longer shared
+    size_t tlb_hits;
+    size_t tlb_misses;
+    size_t resident_frames;
+    size_t swap_used;
+    size_t swap_total;
+    size_t merge_scanned;  // Frames hashed by the merge scanner
+    size_t merge_merged;   // Pages folded into a stable frame
+    size_t merge_saved;    // Frames currently saved by merging
+    size_t merge_passes;   // Full sweeps over the arena
+    uint64_t merge_scan_ns; // Scanner CPU time
+    size_t pages_moved;    // Handed to another space by paging_transfer
+    size_t pages_granted;  // Shared read-only by paging_transfer
+    size_t pages_unmapped; // Taken back by paging_unmap
+} paging_stats_t;
+
+// Function declarations
+int paging_init(const char* swap_path);
+void paging_cleanup(void);
+
+// Address spaces
+address_space_t* paging_create_space(void);
+void paging_destroy_space(address_space_t* space);
+address_space_t* paging_clone_space(address_space_t* source, uint64_t limit);
+int paging_reserve(address_space_t* space, vaddr_t addr, size_t size, int writable);
+int paging_transfer(address_space_t* from, vaddr_t src, address_space_t* to, vaddr_t dst, size_t pages, int mode);
+size_t paging_unmap(address_space_t* space, vaddr_t addr, size_t pages);
+
+// Translation and access
+void* paging_translate(address_space_t* space, vaddr_t addr, int write);
+size_t paging_read(address_space_t* space, vaddr_t addr, void* buffer, size_t size);
+size_t paging_write(address_space_t* space, vaddr_t addr, const void* data, size_t size);
+
+// Page replacement and merging
+size_t paging_reclaim(size_t pages);
+size_t paging_merge_scan(size_t count);
+void paging_get_stats(paging_stats_t* stats);
+
+#endif // PAGING_H
@@ -0,0 +1,111 @@
+#include "pidmap.h"
+#include <stdlib.h>
+
+// Linear probing with backward-shift deletion, kept at most half full. The
+// table lives on the host heap so it can grow without touching the arena.
+static size_t pidmap_hash(uint32_t pid) {
+    return (size_t)((uint64_t)pid * 0x9E3779B97F4A7C15ull >> 17);
+}
+
+static size_t pidmap_slot(const pidmap_t* map, uint32_t pid) {
+    size_t mask = map->capacity - 1;
+    size_t slot = pidmap_hash(pid) & mask;
+    while (map->entries[slot].pid && map->entries[slot].pid != pid) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static int pidmap_grow(pidmap_t* map) {
+    size_t capacity = map->capacity ? map->capacity * 2 : PIDMAP_MIN_CAPACITY;
+    pidmap_entry_t* entries = calloc(capacity, sizeof(pidmap_entry_t));
+    if (!entries) return -1;
+    
+    pidmap_t grown = { entries, capacity, map->count };
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (map->entries[i].pid) {
+            entries[pidmap_slot(&grown, map->entries[i].pid)] = map->entries[i];
+        }
+    }
+    
+    free(map->entries);
+    *map = grown;
+    return 0;
+}
+
+int pidmap_init(pidmap_t* map) {
+    if (!map) return -1;
+    map->entries = NULL;
+    map->capacity = 0;
+    map->count = 0;
+    return pidmap_grow(map);
+}
+
+void pidmap_destroy(pidmap_t* map) {
+    if (!map) return;
+    free(map->entries);
+    map->entries = NULL;
+    map->capacity = 0;
+    map->count = 0;
+}
+
+// Replaces the value of a PID already present
+int pidmap_insert(pidmap_t* map, uint32_t pid, void* value) {
+    if (!map || !map->entries || pid == 0) return -1;
+    
+    size_t slot = pidmap_slot(map, pid);
+    if (!map->entries[slot].pid) {
+        if ((map->count + 1) * 2 > map->capacity) {
+            if (pidmap_grow(map) != 0) return -1;
+            slot = pidmap_slot(map, pid);
+        }
+        map->entries[slot].pid = pid;
+        map->count++;
+    }
+    map->entries[slot].value = value;
+    return 0;
+}
+
+void* pidmap_find(const pidmap_t* map, uint32_t pid) {
+    if (!map || !map->entries || pid == 0) return NULL;
+    
+    const pidmap_entry_t* entry = &map->entries[pidmap_slot(map, pid)];
+    return entry->pid ? entry->value : NULL;
+}
+
+void* pidmap_remove(pidmap_t* map, uint32_t pid) {
+    if (!map || !map->entries || pid == 0) return NULL;
+    
+    size_t mask = map->capacity - 1;
+    size_t slot = pidmap_slot(map, pid);
+    if (!map->entries[slot].pid) return NULL;
+    void* value = map->entries[slot].value;
+    
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask; map->entries[next].pid; next = (next + 1) & mask) {
+        size_t home = pidmap_hash(map->entries[next].pid) & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            map->entries[hole] = map->entries[next];
+            hole = next;
+        }
+    }
+    map->entries[hole].pid = 0;
+    map->entries[hole].value = NULL;
+    map->count--;
+    return value;
+}
+
+// Walk every entry in table order; start with *cursor = 0, NULL at the end.
+// The map must not change during the walk.
+void* pidmap_next(const pidmap_t* map, size_t* cursor, uint32_t* pid) {
+    if (!map || !cursor) return NULL;
+    
+    while (*cursor < map->capacity) {
+        const pidmap_entry_t* entry = &map->entries[(*cursor)++];
+        if (entry->pid) {
+            if (pid) *pid = entry->pid;
+            return entry->value;
+        }
+    }
+    return NULL;
+}
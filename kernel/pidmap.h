@@ -0,0 +1,30 @@
+#ifndef PIDMAP_H
+#define PIDMAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Open-addressed table from PID to an owner's record. PID 0 marks an empty
+// slot, so it is never a valid key.
+#define PIDMAP_MIN_CAPACITY 64 // Power of two
+
+typedef struct {
+    uint32_t pid;
+    void* value;
+} pidmap_entry_t;
+
+typedef struct {
+    pidmap_entry_t* entries;
+    size_t capacity;
+    size_t count;
+} pidmap_t;
+
+// Function declarations
+int pidmap_init(pidmap_t* map);
+void pidmap_destroy(pidmap_t* map);
+int pidmap_insert(pidmap_t* map, uint32_t pid, void* value);
+void* pidmap_find(const pidmap_t* map, uint32_t pid);
+void* pidmap_remove(pidmap_t* map, uint32_t pid);
+void* pidmap_next(const pidmap_t* map, size_t* cursor, uint32_t* pid);
+
+#endif // PIDMAP_H
@@ -0,0 +1,250 @@
+#include "slab.h"
+#include "kernel.h"
+#include <stdio.h>
+#include <string.h>
+
+#define KMEM_SLAB_OFFSET ((sizeof(kmem_slab_t) + KMEM_SLAB_ALIGN - 1) & ~(size_t)(KMEM_SLAB_ALIGN - 1))
+
+// Cache descriptors are themselves allocated from a bootstrap cache
+static kmem_cache_t cache_cache;
+static kmem_cache_t* size_caches[KMEM_SIZE_CLASSES];
+static kmem_cache_t* cache_list = NULL;
+static int kmem_initialized = 0;
+
+static void kmem_cache_setup(kmem_cache_t* cache, const char* name, size_t object_size) {
+    memset(cache, 0, sizeof(*cache));
+    strncpy(cache->name, name, sizeof(cache->name) - 1);
+    cache->object_size = (object_size + KMEM_OBJECT_ALIGN - 1) & ~(size_t)(KMEM_OBJECT_ALIGN - 1);
+    cache->objects_per_slab = (uint32_t)((MEMORY_PAGE_SIZE - KMEM_SLAB_OFFSET) / cache->object_size);
+    
+    cache->next = cache_list;
+    cache_list = cache;
+}
+
+static void kmem_slab_unlink(kmem_slab_t** list, kmem_slab_t* slab) {
+    if (slab->prev) {
+        slab->prev->next = slab->next;
+    } else {
+        *list = slab->next;
+    }
+    if (slab->next) {
+        slab->next->prev = slab->prev;
+    }
+}
+
+static void kmem_slab_link(kmem_slab_t** list, kmem_slab_t* slab) {
+    slab->prev = NULL;
+    slab->next = *list;
+    if (slab->next) {
+        slab->next->prev = slab;
+    }
+    *list = slab;
+}
+
+static kmem_slab_t* kmem_slab_create(kmem_cache_t* cache) {
+    kmem_slab_t* slab = memory_alloc(MEMORY_PAGE_SIZE);
+    if (!slab) return NULL;
+    memory_mark_slab(slab, 1);
+    
+    slab->cache = cache;
+    slab->in_use = 0;
+    slab->free_list = NULL;
+    
+    // Thread every object onto the free list, lowest address first
+    uint8_t* objects = (uint8_t*)slab + KMEM_SLAB_OFFSET;
+    for (uint32_t i = cache->objects_per_slab; i > 0; i--) {
+        void** object = (void**)(objects + (size_t)(i - 1) * cache->object_size);
+        *object = slab->free_list;
+        slab->free_list = object;
+    }
+    
+    kmem_slab_link(&cache->partial, slab);
+    cache->slab_count++;
+    cache->empty_slabs++;
+    return slab;
+}
+
+static void kmem_slab_release(kmem_cache_t* cache, kmem_slab_t* slab, kmem_slab_t** list) {
+    kmem_slab_unlink(list, slab);
+    cache->slab_count--;
+    memory_mark_slab(slab, 0);
+    memory_free(slab);
+}
+
+int kmem_init(void) {
+    if (kmem_initialized) return 0;
+    
+    cache_list = NULL;
+    kmem_cache_setup(&cache_cache, "kmem_cache", sizeof(kmem_cache_t));
+    kmem_initialized = 1;
+    
+    for (int i = 0; i < KMEM_SIZE_CLASSES; i++) {
+        char name[KMEM_NAME_LEN];
+        snprintf(name, sizeof(name), "size-%d", KMEM_MIN_SIZE << i);
+        size_caches[i] = kmem_cache_create(name, (size_t)KMEM_MIN_SIZE << i);
+        if (!size_caches[i]) {
+            kmem_initialized = 0;
+            return -1;
+        }
+    }
+    
+    return 0;
+}
+
+void kmem_cleanup(void) {
+    // Slab pages live in the arena and go away with it
+    memset(size_caches, 0, sizeof(size_caches));
+    cache_list = NULL;
+    kmem_initialized = 0;
+}
+
+kmem_cache_t* kmem_cache_create(const char* name, size_t object_size) {
+    if (!kmem_initialized || !name || object_size == 0 || object_size > KMEM_MAX_SIZE) {
+        return NULL;
+    }
+    
+    kmem_cache_t* cache = kmem_cache_alloc(&cache_cache);
+    if (!cache) return NULL;
+    
+    kmem_cache_setup(cache, name, object_size < sizeof(void*) ? sizeof(void*) : object_size);
+    return cache;
+}
+
+void kmem_cache_destroy(kmem_cache_t* cache) {
+    if (!cache || cache == &cache_cache) return;
+    
+    if (cache->active_objects > 0) {
+        fprintf(stderr, "Slab: Destroying cache '%s' with %zu live objects\n",
+                cache->name, cache->active_objects);
+    }
+    
+    while (cache->partial) {
+        kmem_slab_release(cache, cache->partial, &cache->partial);
+    }
+    while (cache->full) {
+        kmem_slab_release(cache, cache->full, &cache->full);
+    }
+    
+    // Remove from the cache registry
+    kmem_cache_t** link = &cache_list;
+    while (*link && *link != cache) {
+        link = &(*link)->next;
+    }
+    if (*link) {
+        *link = cache->next;
+    }
+    
+    kmem_cache_free(&cache_cache, cache);
+}
+
+void* kmem_cache_alloc(kmem_cache_t* cache) {
+    if (!cache) return NULL;
+    
+    kmem_slab_t* slab = cache->partial;
+    if (!slab) {
+        slab = kmem_slab_create(cache);
+        if (!slab) return NULL;
+    }
+    
+    if (slab->in_use == 0) {
+        cache->empty_slabs--;
+    }
+    
+    void** object = slab->free_list;
+    slab->free_list = *object;
+    slab->in_use++;
+    cache->active_objects++;
+    
+    if (!slab->free_list) {
+        kmem_slab_unlink(&cache->partial, slab);
+        kmem_slab_link(&cache->full, slab);
+    }
+    
+    return object;
+}
+
+void kmem_cache_free(kmem_cache_t* cache, void* ptr) {
+    if (!ptr) return;
+    
+    kmem_slab_t* slab = (kmem_slab_t*)((uintptr_t)ptr & ~(uintptr_t)(MEMORY_PAGE_SIZE - 1));
+    if (slab->cache != cache) {
+        fprintf(stderr, "Slab: Object %p does not belong to cache '%s'\n", ptr, cache ? cache->name : "(null)");
+        return;
+    }
+    
+    if (!slab->free_list) {
+        kmem_slab_unlink(&cache->full, slab);
+        kmem_slab_link(&cache->partial, slab);
+    }
+    
+    *(void**)ptr = slab->free_list;
+    slab->free_list = ptr;
+    slab->in_use--;
+    cache->active_objects--;
+    
+    // Keep one empty slab per cache, give the rest back to the page allocator
+    if (slab->in_use == 0) {
+        if (cache->empty_slabs > 0) {
+            kmem_slab_release(cache, slab, &cache->partial);
+        } else {
+            cache->empty_slabs++;
+        }
+    }
+}
+
+size_t kmem_shrink(void) {
+    size_t released = 0;
+    
+    for (kmem_cache_t* cache = cache_list; cache; cache = cache->next) {
+        kmem_slab_t* slab = cache->partial;
+        while (slab && cache->empty_slabs > 0) {
+            kmem_slab_t* next = slab->next;
+            if (slab->in_use == 0) {
+                kmem_slab_release(cache, slab, &cache->partial);
+                cache->empty_slabs--;
+                released++;
+            }
+            slab = next;
+        }
+    }
+    
+    return released;
+}
+
+void* kmem_alloc(size_t size) {
+    if (!kmem_initialized || size == 0 || size > KMEM_MAX_SIZE) {
+        return NULL;
+    }
+    
+    int index = 0;
+    while (((size_t)KMEM_MIN_SIZE << index) < size) {
+        index++;
+    }
+    
+    return kmem_cache_alloc(size_caches[index]);
+}
+
+void kmem_free(void* ptr) {
+    if (!ptr) return;
+    
+    kmem_slab_t* slab = (kmem_slab_t*)((uintptr_t)ptr & ~(uintptr_t)(MEMORY_PAGE_SIZE - 1));
+    kmem_cache_t* cache = slab->cache;
+    
+    // Anything between objects would corrupt the free list
+    size_t offset = (size_t)((uint8_t*)ptr - (uint8_t*)slab);
+    if (offset < KMEM_SLAB_OFFSET || (offset - KMEM_SLAB_OFFSET) % cache->object_size != 0 ||
+        (offset - KMEM_SLAB_OFFSET) / cache->object_size >= cache->objects_per_slab) {
+        fprintf(stderr, "Slab: %p is not an object in cache '%s'\n", ptr, cache->name);
+        return;
+    }
+    
+    kmem_cache_free(cache, ptr);
+}
+
+void kmem_print_stats(void) {
+    printf("Slab: %-16s %8s %8s %8s\n", "cache", "objsize", "active", "slabs");
+    for (kmem_cache_t* cache = cache_list; cache; cache = cache->next) {
+        printf("Slab: %-16s %8zu %8zu %8zu\n",
+               cache->name, cache->object_size, cache->active_objects, cache->slab_count);
+    }
+}
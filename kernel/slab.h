@@ -0,0 +1,57 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Small allocations up to this size are served from size-class caches
+#define KMEM_MAX_SIZE      1024
+#define KMEM_MIN_SIZE      16
+#define KMEM_SIZE_CLASSES  7  // 16, 32, ..., 1024
+#define KMEM_OBJECT_ALIGN  16
+#define KMEM_SLAB_ALIGN    64 // Objects start this aligned, so size classes are min(size, 64) aligned
+#define KMEM_NAME_LEN      32
+
+struct kmem_cache;
+
+// Slab header, stored at the start of each page-sized slab
+typedef struct kmem_slab {
+    struct kmem_cache* cache;
+    struct kmem_slab* prev;
+    struct kmem_slab* next;
+    void* free_list; // Free objects, linked through their first word
+    uint32_t in_use;
+} kmem_slab_t;
+
+// Object cache for fixed-size objects
+typedef struct kmem_cache {
+    char name[KMEM_NAME_LEN];
+    size_t object_size;
+    uint32_t objects_per_slab;
+    kmem_slab_t* partial; // Slabs with at least one free object
+    kmem_slab_t* full;
+    size_t slab_count;
+    size_t empty_slabs;
+    size_t active_objects;
+    struct kmem_cache* next;
+} kmem_cache_t;
+
+// Function declarations
+int kmem_init(void);
+void kmem_cleanup(void);
+
+// Named object caches
+kmem_cache_t* kmem_cache_create(const char* name, size_t object_size);
+void kmem_cache_destroy(kmem_cache_t* cache);
+void* kmem_cache_alloc(kmem_cache_t* cache);
+void kmem_cache_free(kmem_cache_t* cache, void* ptr);
+size_t kmem_shrink(void);
+
+// Size-class allocation
+void* kmem_alloc(size_t size);
+void kmem_free(void* ptr);
+
+// Diagnostics
+void kmem_print_stats(void);
+
+#endif // SLAB_H
@@ -0,0 +1,288 @@
+#define _GNU_SOURCE
+#include "syscalls.h"
+#include "kernel.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef int64_t (*syscall_fn_t)(void* args);
+
+// Calls into the allocator or a process's local memory run under the kernel
+// lock; the rest take only the locks of whatever they touch
+typedef struct {
+    const char* name;
+    syscall_fn_t fn;
+    int kernel;
+} syscall_entry_t;
+
+static int64_t sys_memory_alloc(void* args) {
+    return (int64_t)(intptr_t)memory_alloc(*(const size_t*)args);
+}
+
+static int64_t sys_memory_free(void* args) {
+    memory_free(args);
+    return 0;
+}
+
+static int64_t sys_process_clone(void* args) {
+    process_t* current = process_get_current();
+    uint32_t pid = args ? *(const uint32_t*)args : (current ? current->pid : 0);
+    return process_clone(pid);
+}
+
+static int64_t sys_memory_stats(void* args) {
+    memory_get_stats((memory_stats_t*)args);
+    return 0;
+}
+
+static int64_t sys_local_alloc(void* args) {
+    vaddr_t addr = process_memory_alloc(process_get_current(), *(const size_t*)args);
+    return addr ? (int64_t)addr : -1;
+}
+
+static int64_t sys_local_reset(void* args) {
+    (void)args;
+    if (!process_get_current()) return -1;
+    process_memory_reset(process_get_current());
+    return 0;
+}
+
+static int64_t sys_aligned_alloc(void* args) {
+    const size_t* request = args;
+    return (int64_t)(intptr_t)memory_alloc_aligned(request[0], request[1]);
+}
+
+static int64_t sys_yield(void* args) {
+    (void)args;
+    process_switch();
+    return 0;
+}
+
+static int64_t sys_exit(void* args) {
+    (void)args;
+    process_exit();
+    return -1; // Only reached outside process context
+}
+
+static int64_t sys_process_stat(void* args) {
+    process_stat_t* stat = args;
+    process_t* current = process_get_current();
+    if (!stat) return -1;
+    return process_get_stat(stat->pid ? stat->pid : (current ? current->pid : 0), stat);
+}
+
+static int64_t sys_sleep(void* args) {
+    return process_sleep(*(const unsigned*)args);
+}
+
+static int64_t sys_futex_wait(void* args) {
+    const futex_request_t* request = args;
+    return futex_wait(request->addr, request->value, request->timeout_ms);
+}
+
+static int64_t sys_futex_wake(void* args) {
+    const futex_request_t* request = args;
+    return futex_wake(request->addr, request->value);
+}
+
+static int64_t sys_ring_enter(void* args);
+
+static int64_t sys_getpid(void* args) {
+    (void)args;
+    process_t* current = process_get_current();
+    return current ? current->pid : 0;
+}
+
+static int64_t sys_page_send(void* args) {
+    const page_send_request_t* request = args;
+    return process_page_send(request->pid, request->addr, request->size, (int)request->flags);
+}
+
+static int64_t sys_page_receive(void* args) {
+    return process_page_receive((page_message_t*)args, 0);
+}
+
+static int64_t sys_page_revoke(void* args) {
+    return process_page_revoke(*(const uint32_t*)args);
+}
+
+static int64_t sys_page_release(void* args) {
+    const page_message_t* message = args;
+    return process_page_release(message->addr, message->size);
+}
+
+static const syscall_entry_t syscall_table[SYSCALL_MAX] = {
+    [SYS_MEMORY_ALLOC]  = {"memory_alloc", sys_memory_alloc, 1},
+    [SYS_MEMORY_FREE]   = {"memory_free", sys_memory_free, 1},
+    [SYS_PROCESS_CLONE] = {"process_clone", sys_process_clone, 0},
+    [SYS_MEMORY_STATS]  = {"memory_stats", sys_memory_stats, 1},
+    [SYS_LOCAL_ALLOC]   = {"local_alloc", sys_local_alloc, 1},
+    [SYS_LOCAL_RESET]   = {"local_reset", sys_local_reset, 1},
+    [SYS_ALIGNED_ALLOC] = {"aligned_alloc", sys_aligned_alloc, 1},
+    [SYS_YIELD]         = {"yield", sys_yield, 0},
+    [SYS_EXIT]          = {"exit", sys_exit, 0},
+    [SYS_PROCESS_STAT]  = {"process_stat", sys_process_stat, 0},
+    [SYS_SLEEP]         = {"sleep", sys_sleep, 0},
+    [SYS_FUTEX_WAIT]    = {"futex_wait", sys_futex_wait, 0},
+    [SYS_FUTEX_WAKE]    = {"futex_wake", sys_futex_wake, 0},
+    [SYS_RING_ENTER]    = {"ring_enter", sys_ring_enter, 0},
+    [SYS_GETPID]        = {"getpid", sys_getpid, 0},
+    [SYS_PAGE_SEND]     = {"page_send", sys_page_send, 0},
+    [SYS_PAGE_RECEIVE]  = {"page_receive", sys_page_receive, 0},
+    [SYS_PAGE_REVOKE]   = {"page_revoke", sys_page_revoke, 0},
+    [SYS_PAGE_RELEASE]  = {"page_release", sys_page_release, 0},
+};
+
+// Latency counters, updated atomically since calls run side by side
+static struct {
+    uint64_t calls;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} syscall_counters[SYSCALL_MAX];
+
+// *clock is the start time on entry and the end time on return, so
+// back-to-back calls in a batch read the clock once each instead of twice
+static int64_t syscall_dispatch(int call_num, void* args, uint64_t* clock) {
+    if (call_num < 0 || call_num >= SYSCALL_MAX || !syscall_table[call_num].fn) {
+        return -1; // Unknown system call
+    }
+    
+    const syscall_entry_t* entry = &syscall_table[call_num];
+    uint64_t start = *clock;
+    if (entry->kernel) {
+        kernel_enter();
+    }
+    int64_t result = entry->fn(args);
+    if (entry->kernel) {
+        kernel_leave();
+    }
+    *clock = scheduler_now_ns();
+    
+    uint64_t elapsed = *clock - start;
+    __atomic_fetch_add(&syscall_counters[call_num].calls, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&syscall_counters[call_num].total_ns, elapsed, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&syscall_counters[call_num].max_ns, __ATOMIC_RELAXED);
+    while (elapsed > max &&
+           !__atomic_compare_exchange_n(&syscall_counters[call_num].max_ns, &max, elapsed, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    return result;
+}
+
+// Run every submitted entry that has room for its completion. A ring
+// cannot enter itself from inside a batch, and SYS_EXIT, which never
+// returns to post its completion, has to be made directly.
+static int64_t sys_ring_enter(void* args) {
+    syscall_ring_t* ring = args;
+    if (!ring || !ring->sqes || !ring->cqes) return -1;
+    
+    uint32_t mask = ring->entries - 1;
+    uint32_t cq_mask = ring->entries * 2 - 1;
+    uint32_t head = ring->sq_head;
+    uint32_t tail = __atomic_load_n(&ring->sq_tail, __ATOMIC_ACQUIRE);
+    uint32_t cq_tail = ring->cq_tail;
+    uint64_t clock = scheduler_now_ns();
+    int64_t consumed = 0;
+    
+    while (head != tail) {
+        uint32_t cq_head = __atomic_load_n(&ring->cq_head, __ATOMIC_ACQUIRE);
+        if (cq_tail - cq_head > cq_mask) break; // Completion queue full
+        
+        const syscall_sqe_t* sqe = &ring->sqes[head & mask];
+        syscall_cqe_t* cqe = &ring->cqes[cq_tail & cq_mask];
+        cqe->user_data = sqe->user_data;
+        cqe->result = sqe->call == SYS_RING_ENTER || sqe->call == SYS_EXIT ? -1 :
+                      syscall_dispatch((int)sqe->call, sqe->args, &clock);
+        head++;
+        cq_tail++;
+        consumed++;
+        
+        // Publish as we go: a blocking call in the batch should not hold
+        // back the completions before it
+        __atomic_store_n(&ring->sq_head, head, __ATOMIC_RELEASE);
+        __atomic_store_n(&ring->cq_tail, cq_tail, __ATOMIC_RELEASE);
+    }
+    return consumed;
+}
+
+int64_t syscall_handler(int call_num, void* args) {
+    uint64_t clock = scheduler_now_ns();
+    return syscall_dispatch(call_num, args, &clock);
+}
+
+// Fills stats with every call made at least once; returns the count, or
+// the number available when max is 0
+size_t syscall_get_stats(syscall_stat_t* stats, size_t max) {
+    size_t count = 0;
+    
+    for (uint32_t i = 0; i < SYSCALL_MAX; i++) {
+        uint64_t calls = __atomic_load_n(&syscall_counters[i].calls, __ATOMIC_RELAXED);
+        if (!syscall_table[i].fn || !calls) continue;
+        if (max) {
+            if (count == max) break;
+            stats[count].call = i;
+            stats[count].name = syscall_table[i].name;
+            stats[count].calls = calls;
+            stats[count].total_ns = __atomic_load_n(&syscall_counters[i].total_ns, __ATOMIC_RELAXED);
+            stats[count].max_ns = __atomic_load_n(&syscall_counters[i].max_ns, __ATOMIC_RELAXED);
+        }
+        count++;
+    }
+    return count;
+}
+
+int syscall_ring_init(syscall_ring_t* ring, uint32_t entries) {
+    if (!ring || entries == 0 || (entries & (entries - 1)) || entries > (1u << 16)) return -1;
+    
+    memset(ring, 0, sizeof(*ring));
+    kernel_enter();
+    ring->sqes = memory_alloc(entries * sizeof(syscall_sqe_t));
+    ring->cqes = memory_alloc(entries * 2 * sizeof(syscall_cqe_t));
+    kernel_leave();
+    if (!ring->sqes || !ring->cqes) {
+        syscall_ring_destroy(ring);
+        return -1;
+    }
+    ring->entries = entries;
+    return 0;
+}
+
+void syscall_ring_destroy(syscall_ring_t* ring) {
+    if (!ring) return;
+    
+    kernel_enter();
+    if (ring->sqes) {
+        memory_free(ring->sqes);
+    }
+    if (ring->cqes) {
+        memory_free(ring->cqes);
+    }
+    kernel_leave();
+    memset(ring, 0, sizeof(*ring));
+}
+
+// Next free submission entry, or NULL while the ring is full
+syscall_sqe_t* syscall_ring_get_sqe(syscall_ring_t* ring) {
+    uint32_t head = __atomic_load_n(&ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sq_local - head >= ring->entries) return NULL;
+    
+    return &ring->sqes[ring->sq_local++ & (ring->entries - 1)];
+}
+
+// Publish the entries handed out so far and run them in one transition;
+// returns how many the kernel consumed
+int64_t syscall_ring_submit(syscall_ring_t* ring) {
+    __atomic_store_n(&ring->sq_tail, ring->sq_local, __ATOMIC_RELEASE);
+    return syscall_handler(SYS_RING_ENTER, ring);
+}
+
+// Oldest unread completion, or NULL if there is none
+syscall_cqe_t* syscall_ring_peek_cqe(syscall_ring_t* ring) {
+    uint32_t tail = __atomic_load_n(&ring->cq_tail, __ATOMIC_ACQUIRE);
+    if (ring->cq_head == tail) return NULL;
+    
+    return &ring->cqes[ring->cq_head & (ring->entries * 2 - 1)];
+}
+
+void syscall_ring_cqe_seen(syscall_ring_t* ring) {
+    __atomic_store_n(&ring->cq_head, ring->cq_head + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,78 @@
+#ifndef SYSCALLS_H
+#define SYSCALLS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// System call numbers; args is the call's argument block, results are 64-bit
+// so pointers survive the return path
+#define SYS_MEMORY_ALLOC   1  // args: size_t size, returns a pointer
+#define SYS_MEMORY_FREE    2  // args: the pointer
+#define SYS_PROCESS_CLONE  3  // args: uint32_t pid, NULL for the caller
+#define SYS_MEMORY_STATS   4  // args: memory_stats_t
+#define SYS_LOCAL_ALLOC    5  // args: size_t size, returns a virtual address
+#define SYS_LOCAL_RESET    6  // args: unused
+#define SYS_ALIGNED_ALLOC  7  // args: size_t {size, alignment}, returns a pointer
+#define SYS_YIELD          8  // args: unused
+#define SYS_EXIT           9  // args: unused
+#define SYS_PROCESS_STAT   10 // args: process_stat_t with pid set, 0 for the caller
+#define SYS_SLEEP          11 // args: unsigned milliseconds
+#define SYS_FUTEX_WAIT     12 // args: futex_request_t
+#define SYS_FUTEX_WAKE     13 // args: futex_request_t with the waiter count in value
+#define SYS_RING_ENTER     14 // args: syscall_ring_t, returns the entries consumed
+#define SYS_GETPID         15 // args: unused, returns the caller's PID or 0
+#define SYS_PAGE_SEND      16 // args: page_send_request_t, returns the grant handle
+#define SYS_PAGE_RECEIVE   17 // args: page_message_t, filled in; waits for one
+#define SYS_PAGE_REVOKE    18 // args: uint32_t grant handle
+#define SYS_PAGE_RELEASE   19 // args: page_message_t of received pages to unmap
+#define SYSCALL_MAX        20
+
+// Submission/completion ring. The process fills submission entries and
+// publishes them by moving sq_tail; SYS_RING_ENTER runs every published
+// entry in one kernel transition and posts a completion for each. Either
+// side only writes its own index, so entries need no locking. SYS_RING_ENTER
+// and SYS_EXIT are refused inside a batch and complete with -1.
+typedef struct {
+    uint32_t call;
+    void* args;
+    uint64_t user_data; // Copied to the completion
+} syscall_sqe_t;
+
+typedef struct {
+    uint64_t user_data;
+    int64_t result;
+} syscall_cqe_t;
+
+typedef struct {
+    uint32_t entries;    // Submission slots, a power of two
+    uint32_t sq_head;    // Advanced by the kernel
+    uint32_t sq_tail;    // Advanced by the process
+    uint32_t sq_local;   // Process-private: entries handed out but not yet submitted
+    uint32_t cq_head;    // Advanced by the process
+    uint32_t cq_tail;    // Advanced by the kernel
+    syscall_sqe_t* sqes;
+    syscall_cqe_t* cqes; // Twice as many slots, so a full batch always completes
+} syscall_ring_t;
+
+// Latency of one system call, batched calls included
+typedef struct {
+    uint32_t call;
+    const char* name;
+    uint64_t calls;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} syscall_stat_t;
+
+// Function declarations
+int64_t syscall_handler(int call_num, void* args);
+size_t syscall_get_stats(syscall_stat_t* stats, size_t max);
+
+// Ring setup and the process side of the protocol
+int syscall_ring_init(syscall_ring_t* ring, uint32_t entries);
+void syscall_ring_destroy(syscall_ring_t* ring);
+syscall_sqe_t* syscall_ring_get_sqe(syscall_ring_t* ring);
+int64_t syscall_ring_submit(syscall_ring_t* ring);
+syscall_cqe_t* syscall_ring_peek_cqe(syscall_ring_t* ring);
+void syscall_ring_cqe_seen(syscall_ring_t* ring);
+
+#endif // SYSCALLS_H
@@ -0,0 +1,194 @@
+#include "timerwheel.h"
+
+#define TIMER_WHEEL_MASK ((uint64_t)TIMER_WHEEL_SIZE - 1)
+
+static unsigned timer_wheel_shift(int level) {
+    return (unsigned)level * TIMER_WHEEL_BITS;
+}
+
+void timer_wheel_init(timer_wheel_t* wheel, uint64_t now) {
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (int slot = 0; slot < TIMER_WHEEL_SIZE; slot++) {
+            wheel->slots[level][slot] = NULL;
+        }
+        wheel->occupied[level] = 0;
+    }
+    wheel->now = now;
+    wheel->pending = 0;
+}
+
+void wheel_timer_init(wheel_timer_t* timer, void (*fn)(void* arg), void* arg) {
+    timer->prev = NULL;
+    timer->next = NULL;
+    timer->expires = 0;
+    timer->fn = fn;
+    timer->arg = arg;
+    timer->level = -1;
+    timer->slot = 0;
+}
+
+int wheel_timer_pending(const wheel_timer_t* timer) {
+    return timer->level >= 0;
+}
+
+// The lowest level whose span covers the remaining time; the slot is where
+// the expiry tick falls at that level
+static void timer_wheel_insert(timer_wheel_t* wheel, wheel_timer_t* timer) {
+    if (timer->expires < wheel->now) {
+        timer->expires = wheel->now; // Overdue: fire on the next tick processed
+    }
+    uint64_t delta = timer->expires - wheel->now;
+    
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >> timer_wheel_shift(level + 1)) {
+        level++;
+    }
+    if (delta >> timer_wheel_shift(TIMER_WHEEL_LEVELS)) {
+        timer->expires = wheel->now + ((uint64_t)1 << timer_wheel_shift(TIMER_WHEEL_LEVELS)) - 1;
+    }
+    int slot = (int)((timer->expires >> timer_wheel_shift(level)) & TIMER_WHEEL_MASK);
+    
+    timer->level = level;
+    timer->slot = slot;
+    timer->prev = NULL;
+    timer->next = wheel->slots[level][slot];
+    if (timer->next) {
+        timer->next->prev = timer;
+    }
+    wheel->slots[level][slot] = timer;
+    wheel->occupied[level] |= (uint64_t)1 << slot;
+}
+
+static void timer_wheel_unlink(timer_wheel_t* wheel, wheel_timer_t* timer) {
+    if (timer->prev) {
+        timer->prev->next = timer->next;
+    } else {
+        wheel->slots[timer->level][timer->slot] = timer->next;
+        if (!timer->next) {
+            wheel->occupied[timer->level] &= ~((uint64_t)1 << timer->slot);
+        }
+    }
+    if (timer->next) {
+        timer->next->prev = timer->prev;
+    }
+    timer->prev = NULL;
+    timer->next = NULL;
+    timer->level = -1;
+}
+
+// Arm, or re-arm, a timer to fire at the given tick
+void timer_wheel_add(timer_wheel_t* wheel, wheel_timer_t* timer, uint64_t expires) {
+    if (wheel_timer_pending(timer)) {
+        timer_wheel_unlink(wheel, timer);
+    } else {
+        wheel->pending++;
+    }
+    timer->expires = expires;
+    timer_wheel_insert(wheel, timer);
+}
+
+// Returns 1 if the timer was pending
+int timer_wheel_cancel(timer_wheel_t* wheel, wheel_timer_t* timer) {
+    if (!wheel_timer_pending(timer)) return 0;
+    
+    timer_wheel_unlink(wheel, timer);
+    wheel->pending--;
+    return 1;
+}
+
+// Tick at which a level's next occupied slot is processed: expiry for level
+// 0, the moment it moves down a level for the others
+static uint64_t timer_wheel_level_next(const timer_wheel_t* wheel, int level) {
+    uint64_t occupied = wheel->occupied[level];
+    if (!occupied) return TIMER_WHEEL_NONE;
+    
+    unsigned shift = timer_wheel_shift(level);
+    uint64_t unit = (wheel->now + ((uint64_t)1 << shift) - 1) >> shift;
+    unsigned offset = (unsigned)(unit & TIMER_WHEEL_MASK);
+    uint64_t rotated = offset ? (occupied >> offset) | (occupied << (TIMER_WHEEL_SIZE - offset)) : occupied;
+    return (unit + (uint64_t)__builtin_ctzll(rotated)) << shift;
+}
+
+// Earliest tick with work to do, TIMER_WHEEL_NONE when nothing is pending.
+// Timers in higher levels may fire later than this; it is never late.
+uint64_t timer_wheel_next(const timer_wheel_t* wheel) {
+    uint64_t next = TIMER_WHEEL_NONE;
+    
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        uint64_t tick = timer_wheel_level_next(wheel, level);
+        if (tick < next) {
+            next = tick;
+        }
+    }
+    return next;
+}
+
+// Move a higher-level slot's timers down now that the wheel reached it
+static void timer_wheel_cascade(timer_wheel_t* wheel, int level, int slot) {
+    wheel_timer_t* timer = wheel->slots[level][slot];
+    
+    wheel->slots[level][slot] = NULL;
+    wheel->occupied[level] &= ~((uint64_t)1 << slot);
+    while (timer) {
+        wheel_timer_t* next = timer->next;
+        timer_wheel_insert(wheel, timer);
+        timer = next;
+    }
+}
+
+// Process every tick up to and including now, skipping ticks with nothing to
+// do. Expired timers are returned as a list linked through next, no longer
+// pending; the caller runs them, typically once it has dropped its lock.
+wheel_timer_t* timer_wheel_advance(timer_wheel_t* wheel, uint64_t now) {
+    wheel_timer_t* expired = NULL;
+    wheel_timer_t** tail = &expired;
+    
+    while (wheel->now <= now) {
+        uint64_t next = timer_wheel_next(wheel);
+        if (next > now) {
+            wheel->now = now + 1;
+            break;
+        }
+        wheel->now = next;
+        
+        // Cascade first, timers due this very tick land in level 0
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            unsigned shift = timer_wheel_shift(level);
+            if (next & (((uint64_t)1 << shift) - 1)) break;
+            timer_wheel_cascade(wheel, level, (int)((next >> shift) & TIMER_WHEEL_MASK));
+        }
+        
+        int slot = (int)(next & TIMER_WHEEL_MASK);
+        wheel_timer_t* timer = wheel->slots[0][slot];
+        wheel->slots[0][slot] = NULL;
+        wheel->occupied[0] &= ~((uint64_t)1 << slot);
+        while (timer) {
+            wheel_timer_t* following = timer->next;
+            timer->prev = NULL;
+            timer->next = NULL;
+            timer->level = -1;
+            wheel->pending--;
+            *tail = timer;
+            tail = &timer->next;
+            timer = following;
+        }
+        wheel->now = next + 1;
+    }
+    return expired;
+}
+
+// Call each expired timer's function; a function may re-arm its own timer
+size_t timer_wheel_run(wheel_timer_t* expired) {
+    size_t count = 0;
+    
+    while (expired) {
+        wheel_timer_t* timer = expired;
+        expired = timer->next;
+        timer->next = NULL;
+        if (timer->fn) {
+            timer->fn(timer->arg);
+        }
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,43 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Hierarchical timer wheel. Level n has 64 slots of 64^n ticks each; a timer
+// sits in the level its remaining time fits and moves down a level as the
+// wheel turns. Timers are embedded in their owner, so adding and cancelling
+// are O(1) and never allocate. The wheel does no locking of its own.
+#define TIMER_WHEEL_BITS   6
+#define TIMER_WHEEL_SIZE   (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 6 // 64^6 ticks, over two years at 1 ms
+#define TIMER_WHEEL_NONE   UINT64_MAX
+
+typedef struct wheel_timer {
+    struct wheel_timer* prev;
+    struct wheel_timer* next; // Also links the list timer_wheel_advance returns
+    uint64_t expires;         // Tick the timer fires at
+    void (*fn)(void* arg);
+    void* arg;
+    int level;                // -1 while not pending
+    int slot;
+} wheel_timer_t;
+
+typedef struct {
+    uint64_t now; // Next tick to process
+    wheel_timer_t* slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SIZE];
+    uint64_t occupied[TIMER_WHEEL_LEVELS]; // Bit n set while slot n holds a timer
+    size_t pending;
+} timer_wheel_t;
+
+// Function declarations
+void timer_wheel_init(timer_wheel_t* wheel, uint64_t now);
+void wheel_timer_init(wheel_timer_t* timer, void (*fn)(void* arg), void* arg);
+void timer_wheel_add(timer_wheel_t* wheel, wheel_timer_t* timer, uint64_t expires);
+int timer_wheel_cancel(timer_wheel_t* wheel, wheel_timer_t* timer);
+wheel_timer_t* timer_wheel_advance(timer_wheel_t* wheel, uint64_t now);
+uint64_t timer_wheel_next(const timer_wheel_t* wheel);
+size_t timer_wheel_run(wheel_timer_t* expired);
+int wheel_timer_pending(const wheel_timer_t* timer);
+
+#endif // TIMERWHEEL_H
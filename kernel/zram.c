@@ -0,0 +1,326 @@
+#define _GNU_SOURCE
+#include "zram.h"
+#include "kernel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static zram_t zram = {0};
+static zram_stats_t zram_stats = {0};
+
+static uint32_t zram_read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t zram_hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - ZRAM_HASH_BITS);
+}
+
+// Length continuation bytes: 255 means "add and keep reading"
+static size_t zram_put_length(uint8_t* output, size_t op, size_t capacity, size_t length) {
+    while (length >= 255) {
+        if (op >= capacity) return 0;
+        output[op++] = 255;
+        length -= 255;
+    }
+    if (op >= capacity) return 0;
+    output[op++] = (uint8_t)length;
+    return op;
+}
+
+// One sequence: token, literals, and a match unless this is the last one
+static size_t zram_emit(uint8_t* output, size_t op, size_t capacity,
+                        const uint8_t* literals, size_t literal_length,
+                        size_t offset, size_t match_length) {
+    if (op >= capacity) return 0;
+    
+    size_t token = op++;
+    size_t match_code = match_length ? match_length - ZRAM_MIN_MATCH : 0;
+    output[token] = (uint8_t)(((literal_length < 15 ? literal_length : 15) << 4) |
+                              (match_code < 15 ? match_code : 15));
+    
+    if (literal_length >= 15) {
+        op = zram_put_length(output, op, capacity, literal_length - 15);
+        if (!op) return 0;
+    }
+    if (op + literal_length > capacity) return 0;
+    memcpy(output + op, literals, literal_length);
+    op += literal_length;
+    
+    if (match_length) {
+        if (op + 2 > capacity) return 0;
+        output[op++] = (uint8_t)(offset & 0xFF);
+        output[op++] = (uint8_t)(offset >> 8);
+        if (match_code >= 15) {
+            op = zram_put_length(output, op, capacity, match_code - 15);
+        }
+    }
+    return op;
+}
+
+// Greedy LZ77 with a single-entry hash table; returns 0 if the output
+// would not fit in capacity
+size_t zram_compress(const uint8_t* input, size_t size, uint8_t* output, size_t capacity) {
+    uint16_t table[1u << ZRAM_HASH_BITS];
+    size_t ip = 0;
+    size_t anchor = 0;
+    size_t op = 0;
+    
+    if (size > UINT16_MAX) return 0;
+    memset(table, 0, sizeof(table));
+    
+    while (ip + ZRAM_MIN_MATCH <= size) {
+        uint32_t sequence = zram_read32(input + ip);
+        uint32_t h = zram_hash(sequence);
+        size_t candidate = table[h];
+        table[h] = (uint16_t)(ip + 1); // Zero marks an empty slot
+        
+        if (!candidate || zram_read32(input + candidate - 1) != sequence) {
+            ip++;
+            continue;
+        }
+        
+        size_t match = candidate - 1;
+        size_t length = ZRAM_MIN_MATCH;
+        while (ip + length < size && input[match + length] == input[ip + length]) {
+            length++;
+        }
+        
+        op = zram_emit(output, op, capacity, input + anchor, ip - anchor, ip - match, length);
+        if (!op) return 0;
+        
+        ip += length;
+        anchor = ip;
+    }
+    
+    return zram_emit(output, op, capacity, input + anchor, size - anchor, 0, 0);
+}
+
+size_t zram_decompress(const uint8_t* input, size_t size, uint8_t* output, size_t capacity) {
+    size_t ip = 0;
+    size_t op = 0;
+    
+    while (ip < size) {
+        uint8_t token = input[ip++];
+        
+        size_t literal_length = token >> 4;
+        if (literal_length == 15) {
+            uint8_t byte;
+            do {
+                if (ip >= size) return 0;
+                byte = input[ip++];
+                literal_length += byte;
+            } while (byte == 255);
+        }
+        if (ip + literal_length > size || op + literal_length > capacity) return 0;
+        memcpy(output + op, input + ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+        
+        if (ip == size) break; // Last sequence carries no match
+        
+        if (ip + 2 > size) return 0;
+        size_t offset = input[ip] | ((size_t)input[ip + 1] << 8);
+        ip += 2;
+        
+        size_t match_length = (token & 0x0F) + ZRAM_MIN_MATCH;
+        if ((token & 0x0F) == 15) {
+            uint8_t byte;
+            do {
+                if (ip >= size) return 0;
+                byte = input[ip++];
+                match_length += byte;
+            } while (byte == 255);
+        }
+        if (offset == 0 || offset > op || op + match_length > capacity) return 0;
+        
+        // Byte by byte: the match may overlap the bytes it produces
+        const uint8_t* match = output + op - offset;
+        for (size_t i = 0; i < match_length; i++) {
+            output[op + i] = match[i];
+        }
+        op += match_length;
+    }
+    
+    return op;
+}
+
+static uint64_t zram_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Grow the host-side entry table so the next store has a handle ready
+static int zram_reserve_entry(void) {
+    if (zram.free_head != ZRAM_NONE) return 0;
+    
+    uint32_t capacity = zram.capacity ? zram.capacity * 2 : 256;
+    zram_entry_t* entries = realloc(zram.entries, sizeof(zram_entry_t) * capacity);
+    if (!entries) return -1;
+    
+    for (uint32_t i = capacity; i > zram.capacity; i--) {
+        entries[i - 1].next_free = zram.free_head;
+        zram.free_head = i - 1;
+    }
+    zram.entries = entries;
+    zram.capacity = capacity;
+    return 0;
+}
+
+static int zram_expand(const uint8_t* data, uint16_t length, uint64_t fill, void* page) {
+    if (!length) {
+        uint8_t* bytes = page;
+        for (size_t i = 0; i < ZRAM_PAGE_SIZE; i += sizeof(fill)) {
+            memcpy(bytes + i, &fill, sizeof(fill));
+        }
+        return 0;
+    }
+    
+    uint64_t start = zram_now_ns();
+    size_t size = zram_decompress(data, length, page, ZRAM_PAGE_SIZE);
+    uint64_t elapsed = zram_now_ns() - start;
+    
+    zram_stats.decompressions++;
+    zram_stats.decompress_ns_total += elapsed;
+    if (elapsed > zram_stats.decompress_ns_max) {
+        zram_stats.decompress_ns_max = elapsed;
+    }
+    
+    return size == ZRAM_PAGE_SIZE ? 0 : -1;
+}
+
+int zram_init(size_t pool_limit) {
+    memset(&zram, 0, sizeof(zram));
+    memset(&zram_stats, 0, sizeof(zram_stats));
+    zram.free_head = ZRAM_NONE;
+    zram.pool_limit = pool_limit;
+    
+    if (pool_limit) {
+        printf("Zram: Compressed page pool limited to %zu bytes\n", pool_limit);
+    } else {
+        printf("Zram: Disabled\n");
+    }
+    return 0;
+}
+
+void zram_cleanup(void) {
+    // Compressed data lives in the arena and goes away with it
+    if (zram.entries) {
+        free(zram.entries);
+        zram.entries = NULL;
+    }
+    zram.capacity = 0;
+    zram.free_head = ZRAM_NONE;
+    zram.pool_bytes = 0;
+}
+
+// Compress a page without allocating anything. Fails when zram is off,
+// the page does not compress below ZRAM_MAX_COMPRESSED or the pool is full.
+int zram_pack(const void* page, zram_packed_t* packed) {
+    if (!zram.pool_limit || !page || !packed) return -1;
+    
+    // Same-filled pages, zero pages above all, need no storage at all
+    const uint8_t* bytes = page;
+    memcpy(&packed->fill, bytes, sizeof(packed->fill));
+    size_t i = sizeof(packed->fill);
+    while (i < ZRAM_PAGE_SIZE && memcmp(bytes + i, &packed->fill, sizeof(packed->fill)) == 0) {
+        i += sizeof(packed->fill);
+    }
+    
+    if (zram_reserve_entry() != 0) return -1;
+    
+    packed->length = 0;
+    if (i < ZRAM_PAGE_SIZE) {
+        size_t length = zram_compress(bytes, ZRAM_PAGE_SIZE, packed->data, sizeof(packed->data));
+        if (!length || zram.pool_bytes + length > zram.pool_limit) {
+            zram_stats.rejected_pages++;
+            return -1;
+        }
+        packed->length = (uint16_t)length;
+    }
+    
+    return 0;
+}
+
+int zram_unpack(const zram_packed_t* packed, void* page) {
+    if (!packed || !page) return -1;
+    return zram_expand(packed->data, packed->length, packed->fill, page);
+}
+
+// Allocates from the arena, so callers free the page's frame first.
+// The entry itself was reserved by zram_pack.
+uint32_t zram_store(const zram_packed_t* packed) {
+    if (!packed || zram.free_head == ZRAM_NONE) return ZRAM_NONE;
+    
+    uint32_t handle = zram.free_head;
+    zram.free_head = zram.entries[handle].next_free;
+    
+    zram_entry_t* entry = &zram.entries[handle];
+    entry->data = NULL;
+    entry->fill = packed->fill;
+    entry->length = packed->length;
+    entry->refs = 1;
+    
+    if (packed->length) {
+        entry->data = memory_alloc(packed->length);
+        if (!entry->data) {
+            entry->next_free = zram.free_head;
+            zram.free_head = handle;
+            zram_stats.rejected_pages++;
+            return ZRAM_NONE;
+        }
+        memcpy(entry->data, packed->data, packed->length);
+        zram.pool_bytes += packed->length;
+    } else {
+        zram_stats.same_filled_pages++;
+    }
+    
+    zram_stats.stored_pages++;
+    zram_stats.original_bytes += ZRAM_PAGE_SIZE;
+    return handle;
+}
+
+int zram_load(uint32_t handle, void* page) {
+    if (handle >= zram.capacity || !page) return -1;
+    
+    zram_entry_t* entry = &zram.entries[handle];
+    return zram_expand(entry->data, entry->length, entry->fill, page);
+}
+
+int zram_ref(uint32_t handle) {
+    if (handle >= zram.capacity || zram.entries[handle].refs == UINT16_MAX) return -1;
+    zram.entries[handle].refs++;
+    return 0;
+}
+
+void zram_free(uint32_t handle) {
+    if (handle >= zram.capacity) return;
+    zram_entry_t* entry = &zram.entries[handle];
+    
+    if (--entry->refs > 0) return;
+    
+    if (entry->data) {
+        memory_free(entry->data);
+        zram.pool_bytes -= entry->length;
+        entry->data = NULL;
+    } else {
+        zram_stats.same_filled_pages--;
+    }
+    zram_stats.stored_pages--;
+    zram_stats.original_bytes -= ZRAM_PAGE_SIZE;
+    
+    entry->next_free = zram.free_head;
+    zram.free_head = handle;
+}
+
+void zram_get_stats(zram_stats_t* stats) {
+    if (!stats) return;
+    
+    *stats = zram_stats;
+    stats->pool_bytes = zram.pool_bytes;
+    stats->pool_limit = zram.pool_limit;
+}
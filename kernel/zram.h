@@ -0,0 +1,67 @@
+#ifndef ZRAM_H
+#define ZRAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Compressed in-memory store for evicted pages, tried before swap
+#define ZRAM_PAGE_SIZE      4096
+#define ZRAM_MAX_COMPRESSED 1024 // Larger results would not save a slab size class
+#define ZRAM_HASH_BITS      12
+#define ZRAM_MIN_MATCH      4
+#define ZRAM_NONE           UINT32_MAX
+
+typedef struct {
+    uint8_t* data;      // Compressed bytes, NULL for a same-filled page
+    uint64_t fill;      // Repeating word of a same-filled page
+    uint32_t next_free;
+    uint16_t length;
+    uint16_t refs;      // Copy-on-write clones share entries
+} zram_entry_t;
+
+typedef struct {
+    zram_entry_t* entries;
+    uint32_t capacity;
+    uint32_t free_head;
+    size_t pool_bytes;  // Compressed bytes currently held
+    size_t pool_limit;
+} zram_t;
+
+// A page compressed on the stack, ready to be stored once its frame is freed
+typedef struct {
+    uint8_t data[ZRAM_MAX_COMPRESSED];
+    uint64_t fill;
+    uint16_t length;    // Zero for a same-filled page
+} zram_packed_t;
+
+typedef struct {
+    size_t stored_pages;
+    size_t same_filled_pages;
+    size_t rejected_pages;  // Incompressible or over the limit, sent to swap
+    size_t pool_bytes;
+    size_t pool_limit;
+    size_t original_bytes;  // Uncompressed size of the stored pages
+    size_t decompressions;
+    uint64_t decompress_ns_total;
+    uint64_t decompress_ns_max;
+} zram_stats_t;
+
+// Function declarations
+int zram_init(size_t pool_limit);
+void zram_cleanup(void);
+
+// Page store; handles are reference counted
+int zram_pack(const void* page, zram_packed_t* packed);
+uint32_t zram_store(const zram_packed_t* packed);
+int zram_unpack(const zram_packed_t* packed, void* page);
+int zram_load(uint32_t handle, void* page);
+int zram_ref(uint32_t handle);
+void zram_free(uint32_t handle);
+
+// LZ codec
+size_t zram_compress(const uint8_t* input, size_t size, uint8_t* output, size_t capacity);
+size_t zram_decompress(const uint8_t* input, size_t size, uint8_t* output, size_t capacity);
+
+void zram_get_stats(zram_stats_t* stats);
+
+#endif // ZRAM_H
@@ -19,6 +19,11 @@ void print_usage(const char* program_name) {
     printf("  --diskimage FILE  Mount disk image file\n");
     printf("  --iso FILE        Mount ISO file as CD/DVD\n");
     printf("  --arch ARCH       Target architecture (x86, arm)\n");
+    printf("  --hugepages       Back large process images with huge pages\n");
+    printf("  --zram SIZE       Cap the compressed page pool (default mem/4, 0 disables)\n");
+    printf("  --memtrace        Trace allocations and report leaks per process\n");
+    printf("  --cpus N          Run processes on N host threads (default 1)\n");
+    printf("  --bcache PCT      Disk buffer cache as a percentage of --mem (default 5, at most 50, 0 disables)\n");
     printf("  --help           Show this help message\n\n");
     printf("Examples:\n");
     printf("  %s --mem 512M --diskimage disk.img\n", program_name);
@@ -31,6 +36,11 @@ int parse_arguments(int argc, char* argv[], mindose_config_t* config) {
         {"diskimage", required_argument, 0, 'd'},
         {"iso", required_argument, 0, 'i'},
         {"arch", required_argument, 0, 'a'},
+        {"hugepages", no_argument, 0, 'H'},
+        {"zram", required_argument, 0, 'z'},
+        {"memtrace", no_argument, 0, 'T'},
+        {"cpus", required_argument, 0, 'c'},
+        {"bcache", required_argument, 0, 'b'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
@@ -44,7 +54,7 @@ int parse_arguments(int argc, char* argv[], mindose_config_t* config) {
     config->arch = "x86";       // Default architecture
     config->application_mode = 1; // Default to application mode
 
-    while ((opt = getopt_long(argc, argv, "m:d:i:a:h", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "m:d:i:a:Hz:Tc:b:h", long_options, &option_index)) != -1) {
         switch (opt) {
             case 'm':
                 config->mem_size = strdup(optarg);
@@ -58,6 +68,28 @@ int parse_arguments(int argc, char* argv[], mindose_config_t* config) {
             case 'a':
                 config->arch = strdup(optarg);
                 break;
+            case 'H':
+                config->huge_pages = 1;
+                break;
+            case 'z':
+                config->zram_size = strdup(optarg);
+                break;
+            case 'T':
+                config->mem_trace = 1;
+                break;
+            case 'c':
+                config->cpus = atoi(optarg);
+                break;
+            case 'b': {
+                char* end;
+                long percent = strtol(optarg, &end, 10);
+                if (end == optarg || *end || percent < 0 || percent > BCACHE_MAX_PERCENT) {
+                    fprintf(stderr, "Invalid --bcache '%s': expected 0 to %d\n", optarg, BCACHE_MAX_PERCENT);
+                    return -1;
+                }
+                config->bcache_percent = percent ? (int)percent : BCACHE_DISABLED;
+                break;
+            }
             case 'h':
                 print_usage(argv[0]);
                 return 0;
@@ -20,6 +20,20 @@ int app_loader_init(void) {
     if (!app_registry.apps) {
         return -1;
     }
+    if (pidmap_init(&app_registry.running) != 0) {
+        free(app_registry.apps);
+        app_registry.apps = NULL;
+        return -1;
+    }
+    
+    // Created before any app is forked so they all inherit its doorbell.
+    // Apps still run without it.
+    char channel_name[IPC_NAME_MAX];
+    snprintf(channel_name, sizeof(channel_name), IPC_APPS_CHANNEL, (int)getpid());
+    app_registry.channel = ipc_channel_create(channel_name, IPC_MPSC, 256, 64);
+    if (!app_registry.channel) {
+        printf("AppLoader: Warning: No message channel for apps\n");
+    }
     
     printf("AppLoader: Initialized\n");
     return 0;
@@ -30,11 +44,18 @@ void app_loader_cleanup(void) {
         free(app_registry.apps);
         app_registry.apps = NULL;
     }
+    pidmap_destroy(&app_registry.running);
+    ipc_channel_close(app_registry.channel);
+    app_registry.channel = NULL;
     app_registry.app_count = 0;
     app_registry.capacity = 0;
     printf("AppLoader: Cleaned up\n");
 }
 
+ipc_channel_t* app_loader_channel(void) {
+    return app_registry.channel;
+}
+
 int app_register(const char* name, const char* executable_path, uint32_t icon_id) {
     if (!name || !executable_path) return -1;
     
@@ -137,6 +158,8 @@ int app_launch(const char* name) {
     if (pid == 0) {
         return -1;
     }
+    size_t index = (size_t)(app - app_registry.apps);
+    pidmap_insert(&app_registry.running, pid, (void*)(uintptr_t)(index + 1));
     
     app->process_id = pid;
     app->is_running = 1;
@@ -157,6 +180,7 @@ int app_terminate(const char* name) {
     
     // Terminate the process
     if (kill(app->process_id, SIGTERM) == 0) {
+        pidmap_remove(&app_registry.running, app->process_id);
         app->is_running = 0;
         app->process_id = 0;
         printf("AppLoader: Terminated '%s'\n", name);
@@ -175,12 +199,10 @@ int app_wait_for_process(uint32_t process_id) {
         printf("AppLoader: Process %u terminated\n", process_id);
         
         // Update app registry
-        for (size_t i = 0; i < app_registry.app_count; i++) {
-            if (app_registry.apps[i].process_id == process_id) {
-                app_registry.apps[i].is_running = 0;
-                app_registry.apps[i].process_id = 0;
-                break;
-            }
+        uintptr_t slot = (uintptr_t)pidmap_remove(&app_registry.running, process_id);
+        if (slot) {
+            app_registry.apps[slot - 1].is_running = 0;
+            app_registry.apps[slot - 1].process_id = 0;
         }
         
         return 1; // Process terminated
@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <stddef.h>
 #include "../common.h"
+#include "../kernel/pidmap.h"
+#include "../kernel/ipc.h"
 
 // Application information
 typedef struct {
@@ -19,11 +21,14 @@ typedef struct {
     app_info_t* apps;
     size_t app_count;
     size_t capacity;
+    pidmap_t running; // Host PID -> index into apps, plus one
+    ipc_channel_t* channel; // IPC_APPS_CHANNEL, inherited by every app launched
 } app_registry_t;
 
 // Function declarations
 int app_loader_init(void);
 void app_loader_cleanup(void);
+ipc_channel_t* app_loader_channel(void);
 
 // Application management
 int app_register(const char* name, const char* executable_path, uint32_t icon_id);
@@ -107,6 +107,23 @@ int load_pe_executable(const void* data, size_t size, loaded_executable_t* exec)
     return 0;
 }
 
+// Mindose has no instruction interpreter, so a loaded program's context
+// stands in for one: it reads its image a page at a time, faulting it in the
+// way a first run would, and yields between pages
+static void process_image_main(void* arg) {
+    process_t* process = process_get_current();
+    size_t size = (size_t)(uintptr_t)arg;
+    uint8_t page[4096];
+    
+    for (size_t offset = 0; offset < size; offset += sizeof(page)) {
+        size_t length = size - offset < sizeof(page) ? size - offset : sizeof(page);
+        kernel_enter();
+        paging_read(process->address_space, PROCESS_MEMORY_BASE + offset, page, length);
+        kernel_leave();
+        process_switch();
+    }
+}
+
 int execute_loaded_program(loaded_executable_t* exec) {
     if (!exec || !exec->entry_point) return -1;
     
@@ -117,14 +134,27 @@ int execute_loaded_program(loaded_executable_t* exec) {
         return -1;
     }
     
-    printf("ProcessManager: Started process %s (PID: %u)\n", exec->filename, pid);
+    // Copy the loaded image into the process's address space; the lookup
+    // and the copy both need the kernel lock
+    kernel_enter();
+    process_t* process = process_find(pid);
+    size_t written = process ? paging_write(process->address_space, PROCESS_MEMORY_BASE,
+                                            exec->base_address, exec->image_size) : 0;
+    kernel_leave();
+    if (written != exec->image_size) {
+        printf("ProcessManager: Failed to map image for %s\n", exec->filename);
+        process_terminate(pid);
+        return -1;
+    }
     
-    // In a real implementation, we would:
-    // 1. Set up the process context
-    // 2. Initialize registers and stack
-    // 3. Jump to the entry point
-    // For now, we just simulate execution
+    // Runs on its own stack the next time the scheduler loop picks it
+    if (process_start(pid, process_image_main, (void*)(uintptr_t)exec->image_size) != 0) {
+        printf("ProcessManager: Failed to start %s\n", exec->filename);
+        process_terminate(pid);
+        return -1;
+    }
     
+    printf("ProcessManager: Started process %s (PID: %u)\n", exec->filename, pid);
     return pid;
 }
 
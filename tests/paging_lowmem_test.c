@@ -0,0 +1,103 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "kernel/kernel.h"
+
+// Clones a process whose pages fill a small arena. The mapping records the
+// clone needs have to come from pages that reclaim frees, and reclaim must
+// not pick a frame the clone is in the middle of sharing. The child has to
+// read back what the parent wrote; the parent goes first, so the child's
+// frames are its own again and can be paged in and out while it checks.
+// The child then grants every page to a third process, which shares frames
+// one at a time the same way. Evicted pages go to a scratch disk image.
+
+#define TEST_MEMORY       "4M"
+#define TEST_PROCESS_SIZE ((size_t)4 << 20) // As large as the arena
+#define TEST_DISK_SIZE    ((off_t)64 << 20)  // Swap gets the last quarter
+
+static int check_pages(const char* who, address_space_t* space, vaddr_t base, size_t pages) {
+    for (size_t i = 0; i < pages; i++) {
+        uint64_t value = 0;
+        vaddr_t addr = base + (vaddr_t)(i * MEMORY_PAGE_SIZE);
+        if (paging_read(space, addr, &value, sizeof(value)) != sizeof(value) || value != i + 1) {
+            fprintf(stderr, "FAIL: %s page %zu reads %llu\n", who, i, (unsigned long long)value);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Fill a process as large as the arena, clone it, check the child and
+// grant its pages on
+static int test_clone(void) {
+    uint32_t pid = process_create("lowmem", NULL, TEST_PROCESS_SIZE);
+    process_t* parent = process_find(pid);
+    if (!parent) {
+        fprintf(stderr, "FAIL: process_create\n");
+        return -1;
+    }
+
+    // One distinct word per page, so a page read back from the wrong
+    // frame or slot shows up
+    size_t pages = TEST_PROCESS_SIZE / MEMORY_PAGE_SIZE;
+    for (size_t i = 0; i < pages; i++) {
+        uint64_t value = i + 1;
+        vaddr_t addr = PROCESS_MEMORY_BASE + (vaddr_t)(i * MEMORY_PAGE_SIZE);
+        if (paging_write(parent->address_space, addr, &value, sizeof(value)) != sizeof(value)) {
+            fprintf(stderr, "FAIL: filling page %zu\n", i);
+            return -1;
+        }
+    }
+
+    uint32_t child_pid = process_clone(pid);
+    process_t* child = process_find(child_pid);
+    if (!child) {
+        fprintf(stderr, "FAIL: process_clone\n");
+        return -1;
+    }
+
+    process_terminate(pid);
+    if (check_pages("child", child->address_space, PROCESS_MEMORY_BASE, pages) != 0) return -1;
+
+    uint32_t receiver_pid = process_create("receiver", NULL, MEMORY_PAGE_SIZE);
+    process_t* receiver = process_find(receiver_pid);
+    if (!receiver || paging_transfer(child->address_space, PROCESS_MEMORY_BASE,
+                                     receiver->address_space, PROCESS_TRANSFER_BASE,
+                                     pages, PAGING_TRANSFER_GRANT) != 0) {
+        fprintf(stderr, "FAIL: granting the child's pages\n");
+        return -1;
+    }
+
+    process_terminate(child_pid);
+    return check_pages("receiver", receiver->address_space, PROCESS_TRANSFER_BASE, pages);
+}
+
+int main(void) {
+    // Kernel log lines go to stderr; the verdict is the exit status
+    if (dup2(STDERR_FILENO, STDOUT_FILENO) < 0) return 1;
+
+    char disk[] = "/tmp/mindose-lowmem-XXXXXX";
+    int fd = mkstemp(disk);
+    if (fd < 0 || ftruncate(fd, TEST_DISK_SIZE) != 0) {
+        fprintf(stderr, "FAIL: creating a disk image\n");
+        return 1;
+    }
+    close(fd);
+
+    mindose_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.mem_size = TEST_MEMORY;
+    config.diskimage = disk;
+    int result = 1;
+    if (kernel_init(&config) != 0) {
+        fprintf(stderr, "FAIL: kernel_init\n");
+    } else {
+        result = test_clone() != 0;
+        kernel_cleanup();
+    }
+
+    unlink(disk);
+    return result;
+}
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "kernel/zram.h"
+
+// Round-trips pages through the zram LZ codec. Besides whole pages that are
+// all zero, random and periodic, single-sequence inputs put the literal run
+// and the match length code exactly on 15 (the token's escape value) and
+// 270 (15 plus one 255 continuation byte). Every truncation of those
+// streams that cuts a length, a literal run or an offset short has to
+// decode to 0, as does decoding into a buffer one byte too small.
+
+#define TEST_CAPACITY (2 * ZRAM_PAGE_SIZE) // Room for incompressible input
+
+static uint64_t test_rng = 1;
+
+static uint8_t test_random_byte(void) {
+    // xorshift64*
+    test_rng ^= test_rng >> 12;
+    test_rng ^= test_rng << 25;
+    test_rng ^= test_rng >> 27;
+    return (uint8_t)((test_rng * 0x2545F4914F6CDD1Dull) >> 56);
+}
+
+// Compress, then decompress into a buffer of exactly the input size and
+// into one a byte short; returns the compressed length, 0 on failure
+static size_t roundtrip(const char* what, const uint8_t* input, size_t size, uint8_t* packed) {
+    uint8_t output[ZRAM_PAGE_SIZE];
+
+    size_t length = zram_compress(input, size, packed, TEST_CAPACITY);
+    if (!length) {
+        fprintf(stderr, "FAIL: %s does not compress\n", what);
+        return 0;
+    }
+    memset(output, 0xA5, sizeof(output));
+    if (zram_decompress(packed, length, output, size) != size || memcmp(output, input, size) != 0) {
+        fprintf(stderr, "FAIL: %s does not round-trip\n", what);
+        return 0;
+    }
+    if (zram_decompress(packed, length, output, size - 1) != 0) {
+        fprintf(stderr, "FAIL: %s decodes past its capacity\n", what);
+        return 0;
+    }
+    return length;
+}
+
+static int test_pages(void) {
+    uint8_t page[ZRAM_PAGE_SIZE];
+    uint8_t packed[TEST_CAPACITY];
+
+    memset(page, 0, sizeof(page));
+    if (!roundtrip("zero page", page, sizeof(page), packed)) return -1;
+
+    for (size_t i = 0; i < sizeof(page); i++) {
+        page[i] = test_random_byte();
+    }
+    if (!roundtrip("random page", page, sizeof(page), packed)) return -1;
+    if (zram_compress(page, sizeof(page), packed, ZRAM_MAX_COMPRESSED) != 0) {
+        fprintf(stderr, "FAIL: random page fits in %d bytes\n", ZRAM_MAX_COMPRESSED);
+        return -1;
+    }
+
+    // Periods shorter than a match overlap the bytes they copy
+    static const size_t periods[] = {1, 3, 7, 64, 1000};
+    for (size_t p = 0; p < sizeof(periods) / sizeof(periods[0]); p++) {
+        char what[32];
+        snprintf(what, sizeof(what), "period %zu page", periods[p]);
+        for (size_t i = 0; i < sizeof(page); i++) {
+            page[i] = (uint8_t)(i % periods[p] * 37 + 1);
+        }
+        if (!roundtrip(what, page, sizeof(page), packed)) return -1;
+    }
+    return 0;
+}
+
+// Bytes a length of value takes after its token nibble
+static size_t extra_bytes(size_t value) {
+    return value < 15 ? 0 : 1 + (value - 15) / 255;
+}
+
+// literals random bytes, then match bytes copied from the start, which the
+// compressor has to emit as one sequence and an empty last one
+static int test_sequence(size_t literals, size_t match) {
+    uint8_t input[ZRAM_PAGE_SIZE];
+    uint8_t packed[TEST_CAPACITY];
+    uint8_t output[ZRAM_PAGE_SIZE];
+    char what[48];
+
+    snprintf(what, sizeof(what), "%zu literals and a %zu-byte match", literals, match);
+    for (size_t i = 0; i < literals; i++) {
+        input[i] = test_random_byte();
+    }
+    for (size_t i = 0; i < match; i++) {
+        input[literals + i] = input[i];
+    }
+
+    size_t size = literals + match;
+    size_t length = roundtrip(what, input, size, packed);
+    if (!length) return -1;
+
+    // Where the offset starts; a stream without a match ends there
+    size_t offset = 1 + extra_bytes(literals) + literals;
+    size_t expected = match ? offset + 2 + extra_bytes(match - ZRAM_MIN_MATCH) + 1 : offset;
+    if (length != expected) {
+        fprintf(stderr, "FAIL: %s compresses to %zu bytes, not %zu\n", what, length, expected);
+        return -1;
+    }
+
+    // Only the cut right after the literals and the one after the match,
+    // which drops the empty last sequence, end on a sequence boundary
+    size_t complete = match ? length - 1 : length;
+    for (size_t cut = 1; cut < complete; cut++) {
+        if (cut == offset) continue;
+        if (zram_decompress(packed, cut, output, sizeof(output)) != 0) {
+            fprintf(stderr, "FAIL: %s truncated to %zu bytes decodes\n", what, cut);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(void) {
+    static const size_t sequences[][2] = {
+        {15, 0}, {270, 0},
+        {15, 15}, {15, 19},    // Match codes 11 and 15
+        {270, 270}, {270, 274} // Match codes 266 and 270
+    };
+
+    if (test_pages() != 0) return 1;
+    for (size_t i = 0; i < sizeof(sequences) / sizeof(sequences[0]); i++) {
+        if (test_sequence(sequences[i][0], sequences[i][1]) != 0) return 1;
+    }
+    return 0;
+}